@@ -0,0 +1,88 @@
+#include "candidate_table.h"
+
+#include <algorithm>
+
+#define CANDIDATE_TABLE_INIT_BITS (10)
+
+void CandidateTable::clear() {
+    uint32_t bits = CANDIDATE_TABLE_INIT_BITS;
+    while ((1ull << bits) < _size * 2) {
+        bits++;
+    }
+    _shift = 64 - bits;
+    _slots.assign(1ull << bits, Slot {CANDIDATE_EMPTY_KEY, 0, 0, 0, 0});
+    _size = 0;
+    _staged_id.clear();
+    _staged.clear();
+    _nr_positions = 0;
+}
+
+void CandidateTable::reserve(size_t n) {
+    // Keep growth geometric, reserve() is called once per ElePos partition
+    size_t needed = _staged.size() + n;
+    if (needed <= _staged.capacity()) return;
+    needed = std::max(needed, _staged.capacity() * 2);
+    _staged_id.reserve(needed);
+    _staged.reserve(needed);
+}
+
+void CandidateTable::grow() {
+    std::vector<Slot> old_slots;
+    old_slots.swap(_slots);
+    _shift--;
+    _slots.assign(old_slots.size() * 2, Slot {CANDIDATE_EMPTY_KEY, 0, 0, 0, 0});
+
+    uint32_t mask = _slots.size() - 1;
+    for (const Slot& old_slot : old_slots) {
+        if (old_slot.key == CANDIDATE_EMPTY_KEY) continue;
+        uint32_t idx = hash(old_slot.key);
+        while (_slots[idx].key != CANDIDATE_EMPTY_KEY) {
+            idx = (idx + 1) & mask;
+        }
+        _slots[idx] = old_slot;
+    }
+}
+
+void CandidateTable::finalize() {
+    // Counting sort of the staged positions by key
+    std::vector<uint32_t> fill(_size);
+    uint32_t offset = 0;
+    for (Slot& slot : _slots) {
+        if (slot.key == CANDIDATE_EMPTY_KEY) continue;
+        slot.offset = offset;
+        fill[slot.id] = offset;
+        offset += slot.count;
+    }
+
+    _nr_positions = _staged.size();
+    if (_nr_positions > _positions_capacity) {
+        _positions_capacity = std::max(_nr_positions, _positions_capacity * 2);
+        _positions.reset(new CandidatePos[_positions_capacity]);
+    }
+    for (size_t i = 0; i < _staged.size(); ++i) {
+        _positions[fill[_staged_id[i]]++] = _staged[i];
+    }
+
+    // Coalesce repeated positions of a key, they would walk the same ancestors at the next level
+    for (Slot& slot : _slots) {
+        if (slot.key == CANDIDATE_EMPTY_KEY || slot.count < 2) continue;
+        CandidatePos* begin = _positions.get() + slot.offset;
+        CandidatePos* end = begin + slot.count;
+        std::sort(begin, end, [](const CandidatePos& a, const CandidatePos& b) {
+            return a.suffix_item_pos < b.suffix_item_pos;
+        });
+        CandidatePos* out = begin;
+        for (CandidatePos* pos = begin + 1; pos != end; ++pos) {
+            if (pos->suffix_item_pos == out->suffix_item_pos) {
+                out->support += pos->support;
+            } else {
+                *++out = *pos;
+            }
+        }
+        slot.count = out - begin + 1;
+    }
+
+    // Staging buffers keep their capacity for the next level, fresh pages cost more than the copy
+    _staged_id.clear();
+    _staged.clear();
+}
@@ -0,0 +1,124 @@
+#ifndef CANDIDATE_TABLE_H
+#define CANDIDATE_TABLE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#define CANDIDATE_EMPTY_KEY (~0ull)
+
+struct CandidatePos {
+    uint32_t suffix_item_pos;
+    uint32_t support;
+};
+
+// Flat open-addressing table keyed by the packed (prefix, suffix) key, filled in two
+// phases: supports first, then only the positions of frequent keys.
+// Each slot aggregates the support of its key and, after finalize(), owns the
+// range [offset, offset + count) of one shared position array, sorted by position.
+// Positions are staged against the insertion id of their key, which survives rehashing.
+class CandidateTable {
+public:
+    struct Slot {
+        uint64_t key;
+        uint32_t support;
+        uint32_t count;
+        uint32_t offset;
+        uint32_t id;
+    };
+
+    CandidateTable(): _size(0) { clear(); }
+
+    static uint64_t make_key(uint32_t prefix_item, uint32_t suffix_item) {
+        return (static_cast<uint64_t>(prefix_item) << 32) | suffix_item;
+    }
+    static uint32_t prefix_of(uint64_t key) { return static_cast<uint32_t>(key >> 32); }
+    static uint32_t suffix_of(uint64_t key) { return static_cast<uint32_t>(key); }
+    // All keys of one prefix itemset go to the same partition
+    static uint32_t partition_of(uint32_t prefix_item, uint32_t nr_partitions) { return prefix_item % nr_partitions; }
+
+    // Phase 1: aggregate the support of a key
+    void add_support(uint64_t key, uint32_t support) {
+        if ((_size + 1) * 2 > _slots.size()) {
+            grow();
+        }
+        _slots[find_or_insert(key)].support += support;
+    }
+
+    // Phase 2: stage one position of a key counted in phase 1
+    void add_position(uint64_t key, uint32_t suffix_item_pos, uint32_t support) {
+        Slot& slot = _slots[find_index(key)];
+        slot.count++;
+        _staged_id.push_back(slot.id);
+        _staged.push_back({suffix_item_pos, support});
+    }
+
+    // Slot of a key, or nullptr if it was never added
+    const Slot* find(uint64_t key) const {
+        int64_t idx = find_index(key);
+        return idx < 0 ? nullptr : &_slots[idx];
+    }
+
+    // Make room for n more add_position() calls without reallocating the staging buffers
+    void reserve(size_t n);
+
+    // Group all added positions by key and merge the repeated positions of a key,
+    // must be called before positions() is used
+    void finalize();
+    // Empty the table, sized for about as many keys as it held before
+    void clear();
+
+    size_t size() const { return _size; }
+    size_t nr_positions() const { return _nr_positions; }
+    const std::vector<Slot>& slots() const { return _slots; }
+    const CandidatePos* positions(const Slot& slot) const { return _positions.get() + slot.offset; }
+
+private:
+    std::vector<Slot> _slots;
+    uint32_t _shift;
+    size_t _size;
+    std::vector<uint32_t> _staged_id;
+    std::vector<CandidatePos> _staged;
+    // Left uninitialized, every entry is written by finalize()
+    std::unique_ptr<CandidatePos[]> _positions;
+    size_t _positions_capacity = 0;
+    size_t _nr_positions = 0;
+
+    // Only the prefix is scrambled, keys sharing a prefix land in neighbouring slots.
+    // Candidates of one ElePos walk share their prefix, so this keeps the merge cache friendly.
+    uint32_t hash(uint64_t key) const {
+        uint64_t prefix_hash = (static_cast<uint64_t>(prefix_of(key)) * 0x9E3779B97F4A7C15ull) >> _shift;
+        return static_cast<uint32_t>((prefix_hash + suffix_of(key)) & (_slots.size() - 1));
+    }
+
+    int64_t find_index(uint64_t key) const {
+        uint32_t mask = _slots.size() - 1;
+        uint32_t idx = hash(key);
+        while (true) {
+            const Slot& slot = _slots[idx];
+            if (slot.key == key) return idx;
+            if (slot.key == CANDIDATE_EMPTY_KEY) return -1;
+            idx = (idx + 1) & mask;
+        }
+    }
+
+    uint32_t find_or_insert(uint64_t key) {
+        uint32_t mask = _slots.size() - 1;
+        uint32_t idx = hash(key);
+        while (true) {
+            Slot& slot = _slots[idx];
+            if (slot.key == key) return idx;
+            if (slot.key == CANDIDATE_EMPTY_KEY) {
+                slot.key = key;
+                slot.id = _size++;
+                return idx;
+            }
+            idx = (idx + 1) & mask;
+        }
+    }
+
+    void grow();
+};
+
+#endif
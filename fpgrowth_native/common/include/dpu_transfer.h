@@ -0,0 +1,96 @@
+#ifndef DPU_TRANSFER_H
+#define DPU_TRANSFER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <dpu>
+
+// Ragged scatter/gather of per-DPU buffers.
+// A push moves one size to every DPU of a set and the DPUs of a rank are written in lockstep,
+// so the rank is the finest granularity a size can change at. Every rank carries its own
+// largest buffer instead of the largest one of the whole system, and ranks transfer in parallel
+// through their async queues.
+
+// Number of DPUs of every rank, in the order of system.dpus()
+inline std::vector<uint32_t> dpus_per_rank(dpu::DpuSet& system) {
+    std::vector<uint32_t> sizes;
+    for (dpu::DpuSet* rank : system.ranks()) {
+        sizes.push_back(rank->dpus().size());
+    }
+    return sizes;
+}
+
+// Entries a transfer of at least n entries must move, transfer sizes are multiples of 8 bytes
+template <typename T>
+size_t transfer_entries(size_t n) {
+    while ((n * sizeof(T)) % 8 != 0) n++;
+    return n;
+}
+
+// Group per-DPU buffers by rank, each padded with pad to the largest buffer of its rank
+template <typename T>
+std::vector<std::vector<std::vector<T>>> group_by_rank(const std::vector<uint32_t>& rank_sizes,
+                                                       std::vector<std::vector<T>>&& buffers, const T& pad) {
+    std::vector<std::vector<std::vector<T>>> by_rank(rank_sizes.size());
+    size_t dpu = 0;
+    for (size_t r = 0; r < rank_sizes.size(); ++r) {
+        size_t max_size = 0;
+        for (uint32_t i = 0; i < rank_sizes[r]; ++i) {
+            max_size = std::max(max_size, buffers[dpu + i].size());
+        }
+        max_size = transfer_entries<T>(max_size);
+        for (uint32_t i = 0; i < rank_sizes[r]; ++i, ++dpu) {
+            buffers[dpu].resize(max_size, pad);
+            by_rank[r].push_back(std::move(buffers[dpu]));
+        }
+    }
+    return by_rank;
+}
+
+// Queue the copy of every rank's buffers to symbol + offset, the caller syncs.
+// The buffers must stay alive until then.
+template <typename T>
+void push_ragged(dpu::DpuSet& system, const std::string& symbol, uint32_t offset,
+                 const std::vector<std::vector<std::vector<T>>>& by_rank) {
+    std::vector<dpu::DpuSet*>& ranks = system.ranks();
+    for (size_t r = 0; r < by_rank.size(); ++r) {
+        if (by_rank[r].empty() || by_rank[r][0].empty()) continue;
+        ranks[r]->async().copy(symbol, offset, by_rank[r]);
+    }
+}
+
+// Read counts[i] entries from symbol + offset of DPU i, each rank reads its largest count.
+// Buffers hold at least counts[i] entries.
+template <typename T>
+std::vector<std::vector<T>> gather_ragged(dpu::DpuSet& system, const std::string& symbol, uint32_t offset,
+                                          const std::vector<uint32_t>& counts) {
+    std::vector<dpu::DpuSet*>& ranks = system.ranks();
+    std::vector<std::vector<std::vector<T>>> by_rank(ranks.size());
+    size_t dpu = 0;
+    for (size_t r = 0; r < ranks.size(); ++r) {
+        size_t nr_dpus = ranks[r]->dpus().size();
+        uint32_t max_count = 0;
+        for (size_t i = 0; i < nr_dpus; ++i) {
+            max_count = std::max(max_count, counts[dpu + i]);
+        }
+        by_rank[r].assign(nr_dpus, std::vector<T>(transfer_entries<T>(max_count)));
+        if (max_count > 0) {
+            ranks[r]->async().copy(by_rank[r], symbol, offset);
+        }
+        dpu += nr_dpus;
+    }
+    system.async().sync();
+
+    std::vector<std::vector<T>> buffers;
+    buffers.reserve(dpu);
+    for (std::vector<std::vector<T>>& rank_buffers : by_rank) {
+        for (std::vector<T>& buffer : rank_buffers) {
+            buffers.push_back(std::move(buffer));
+        }
+    }
+    return buffers;
+}
+
+#endif // DPU_TRANSFER_H
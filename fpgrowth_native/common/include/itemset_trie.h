@@ -0,0 +1,75 @@
+#ifndef ITEMSET_TRIE_H
+#define ITEMSET_TRIE_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Binary prefix-trie encoding of mined itemsets.
+//
+// File layout (little endian):
+//   TrieHeader
+//   TrieRecord[nr_nodes]
+//
+// 1-itemsets use their item as node id. Larger itemsets use id_base + index,
+// with the parent being the id of the prefix itemset. Parents always precede
+// their children, so a single forward pass can rebuild every itemset.
+
+#define TRIE_MAGIC (0x52545046u) // "FPTR"
+#define TRIE_VERSION (1u)
+#define TRIE_ROOT (0xFFFFFFFFu)
+
+struct TrieHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t id_base;
+    uint32_t reserved;
+    uint64_t nr_nodes;
+};
+
+struct TrieRecord {
+    uint32_t node_id;
+    uint32_t parent_id;
+    uint32_t item;
+    uint32_t support;
+};
+
+void write_itemset_trie(const std::string& path, uint32_t id_base,
+                        const std::vector<std::pair<uint32_t, uint32_t>>& itemsets_1,
+                        const std::vector<uint32_t>& supports_1,
+                        const std::vector<std::pair<uint32_t, uint32_t>>& itemsets_gt1,
+                        const std::vector<uint32_t>& supports_gt1);
+
+class ItemsetTrie {
+public:
+    explicit ItemsetTrie(const std::string& path);
+
+    size_t size() const { return _records.size(); }
+    const TrieRecord& record(size_t idx) const { return _records[idx]; }
+
+    // Index of a node id, or -1 if it is not in the trie
+    int64_t find(uint32_t node_id) const;
+    int64_t parent(size_t idx) const;
+
+    // Child indices of a record (or of the root for TRIE_ROOT), without expanding any itemset
+    std::pair<const uint32_t*, const uint32_t*> children(size_t idx) const;
+    std::pair<const uint32_t*, const uint32_t*> root_children() const;
+
+    // Items of the itemset ending at idx, from the first prefix item to the suffix item
+    void expand(size_t idx, std::vector<uint32_t>& items) const;
+    void for_each_itemset(const std::function<void(const std::vector<uint32_t>&, uint32_t)>& fn) const;
+
+private:
+    uint32_t _id_base;
+    std::vector<TrieRecord> _records;
+    std::vector<int64_t> _item_index;   // 1-itemset node id -> record index
+    size_t _gt1_begin;                  // Records with node_id >= _id_base start here
+    std::vector<uint32_t> _child_offsets;
+    std::vector<uint32_t> _child_indices;
+
+    void build_children();
+};
+
+#endif
@@ -0,0 +1,139 @@
+#include "itemset_trie.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+void write_itemset_trie(const std::string& path, uint32_t id_base,
+                        const std::vector<std::pair<uint32_t, uint32_t>>& itemsets_1,
+                        const std::vector<uint32_t>& supports_1,
+                        const std::vector<std::pair<uint32_t, uint32_t>>& itemsets_gt1,
+                        const std::vector<uint32_t>& supports_gt1) {
+    std::ofstream output(path, std::ios::binary);
+    if (!output.is_open()) {
+        throw std::runtime_error("Could not open file: " + path);
+    }
+
+    TrieHeader header = {TRIE_MAGIC, TRIE_VERSION, id_base, 0, itemsets_1.size() + itemsets_gt1.size()};
+    output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    std::vector<TrieRecord> records;
+    records.reserve(header.nr_nodes);
+    for (size_t i = 0; i < itemsets_1.size(); ++i) {
+        records.push_back({itemsets_1[i].first, TRIE_ROOT, itemsets_1[i].first, supports_1[i]});
+    }
+    for (size_t i = 0; i < itemsets_gt1.size(); ++i) {
+        uint32_t node_id = id_base + static_cast<uint32_t>(i);
+        records.push_back({node_id, itemsets_gt1[i].first, itemsets_gt1[i].second, supports_gt1[i]});
+    }
+    output.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(TrieRecord));
+}
+
+ItemsetTrie::ItemsetTrie(const std::string& path): _id_base(0), _gt1_begin(0) {
+    std::ifstream input(path, std::ios::binary);
+    if (!input.is_open()) {
+        throw std::runtime_error("Could not open file: " + path);
+    }
+
+    TrieHeader header;
+    if (!input.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != TRIE_MAGIC) {
+        throw std::runtime_error("Not an itemset trie: " + path);
+    }
+    if (header.version != TRIE_VERSION) {
+        throw std::runtime_error("Unsupported itemset trie version: " + std::to_string(header.version));
+    }
+
+    _id_base = header.id_base;
+    _records.resize(header.nr_nodes);
+    if (!input.read(reinterpret_cast<char*>(_records.data()), _records.size() * sizeof(TrieRecord))) {
+        throw std::runtime_error("Truncated itemset trie: " + path);
+    }
+
+    _item_index.assign(_id_base, -1);
+    _gt1_begin = _records.size();
+    for (size_t i = 0; i < _records.size(); ++i) {
+        if (_records[i].node_id < _id_base) {
+            _item_index[_records[i].node_id] = i;
+        } else if (_gt1_begin == _records.size()) {
+            _gt1_begin = i;
+        }
+    }
+
+    build_children();
+}
+
+int64_t ItemsetTrie::find(uint32_t node_id) const {
+    if (node_id < _id_base) {
+        return _item_index[node_id];
+    }
+    size_t idx = _gt1_begin + (node_id - _id_base);
+    if (idx < _records.size() && _records[idx].node_id == node_id) {
+        return idx;
+    }
+    return -1;
+}
+
+int64_t ItemsetTrie::parent(size_t idx) const {
+    if (_records[idx].parent_id == TRIE_ROOT) return -1;
+    return find(_records[idx].parent_id);
+}
+
+void ItemsetTrie::build_children() {
+    // CSR adjacency, slot size() is the root
+    size_t nr_slots = _records.size() + 1;
+    std::vector<int64_t> parents(_records.size());
+    _child_offsets.assign(nr_slots + 1, 0);
+    for (size_t i = 0; i < _records.size(); ++i) {
+        parents[i] = parent(i);
+        size_t slot = parents[i] < 0 ? _records.size() : parents[i];
+        _child_offsets[slot + 1]++;
+    }
+    for (size_t s = 0; s < nr_slots; ++s) {
+        _child_offsets[s + 1] += _child_offsets[s];
+    }
+
+    std::vector<uint32_t> fill(_child_offsets.begin(), _child_offsets.end() - 1);
+    _child_indices.resize(_records.size());
+    for (size_t i = 0; i < _records.size(); ++i) {
+        size_t slot = parents[i] < 0 ? _records.size() : parents[i];
+        _child_indices[fill[slot]++] = i;
+    }
+}
+
+std::pair<const uint32_t*, const uint32_t*> ItemsetTrie::children(size_t idx) const {
+    const uint32_t* base = _child_indices.data();
+    return {base + _child_offsets[idx], base + _child_offsets[idx + 1]};
+}
+
+std::pair<const uint32_t*, const uint32_t*> ItemsetTrie::root_children() const {
+    return children(_records.size());
+}
+
+void ItemsetTrie::expand(size_t idx, std::vector<uint32_t>& items) const {
+    items.clear();
+    int64_t current = idx;
+    while (current >= 0) {
+        items.push_back(_records[current].item);
+        current = parent(current);
+    }
+    std::reverse(items.begin(), items.end());
+}
+
+void ItemsetTrie::for_each_itemset(const std::function<void(const std::vector<uint32_t>&, uint32_t)>& fn) const {
+    // Depth-first over the trie, each prefix is extended in place instead of re-walking parents
+    std::vector<uint32_t> items;
+    std::vector<std::pair<const uint32_t*, const uint32_t*>> stack;
+    stack.push_back(root_children());
+    while (!stack.empty()) {
+        auto& top = stack.back();
+        if (top.first == top.second) {
+            stack.pop_back();
+            if (!items.empty()) items.pop_back();
+            continue;
+        }
+        uint32_t idx = *top.first++;
+        items.push_back(_records[idx].item);
+        fn(items, _records[idx].support);
+        stack.push_back(children(idx));
+    }
+}
@@ -6,6 +6,7 @@ INPUT_DIR="heavy_input"
 OUTPUT_DIR="heavy_output"
 ORIGINAL_EXE="original/fpgrowth"
 PFP_EXE="pfp_growth/fpgrowth_cpu"
+PFP_ARGS=(--engine fptree) # Compare the FP-tree miner, not whatever --engine auto picks
 UPMEM_EXE="upmem_hist/build/main"
 HYBRID_EXE="upmem_hybrid/build/main"
 
@@ -61,7 +62,7 @@ for dataset in "${!min_supports[@]}"; do
         
         echo "Running pfp_growth C++ on $input_file with min_support=$min_support..."
         start_time=$(date +%s.%N)
-        sudo LD_LIBRARY_PATH=$LD_LIBRARY_PATH "$PFP_EXE" "$input_file" "$min_support" "$OUTPUT_DIR/${base_name}_ms${min_support}_pfp.txt"
+        sudo LD_LIBRARY_PATH=$LD_LIBRARY_PATH "$PFP_EXE" "$input_file" "$min_support" "$OUTPUT_DIR/${base_name}_ms${min_support}_pfp.txt" "${PFP_ARGS[@]}"
         end_time=$(date +%s.%N)
         pfp_time=$(echo "$end_time - $start_time" | bc)
         
@@ -10,6 +10,7 @@ OUTPUT_DIR="output"
 PERF_OUTPUT_DIR="perf_results"
 ORIGINAL_EXE="original/fpgrowth"
 PFP_EXE="pfp_growth/fpgrowth_cpu"
+PFP_ARGS=(--engine fptree) # Compare the FP-tree miner, not whatever --engine auto picks
 UPMEM_EXE="upmem/build/main"
 PY_SCRIPT="python/fp_growth.py"
 VENV_DIR="python/venv"
@@ -105,18 +106,19 @@ run_perf_benchmark() {
     local min_support="$4"
     local output_file="$5"
     local perf_output="$6"
+    local extra_args=("${@:7}") # Options after the perf output file go to the executable
     
     echo "Running benchmark on $exe_name..."
     if [ -f "$exe_path" ]; then
         if [ "$PERF_AVAILABLE" = true ]; then
             # Run with full perf stats
-            sudo LD_LIBRARY_PATH=$LD_LIBRARY_PATH $PERF_CMD -e cycles,instructions,cache-references,cache-misses,branch-instructions,branch-misses,page-faults,context-switches,cpu-migrations,L1-dcache-loads,L1-dcache-load-misses,LLC-loads,LLC-load-misses,dTLB-loads,dTLB-load-misses -o "$perf_output" "$exe_path" "$input_file" "$min_support" "$output_file"
+            sudo LD_LIBRARY_PATH=$LD_LIBRARY_PATH $PERF_CMD -e cycles,instructions,cache-references,cache-misses,branch-instructions,branch-misses,page-faults,context-switches,cpu-migrations,L1-dcache-loads,L1-dcache-load-misses,LLC-loads,LLC-load-misses,dTLB-loads,dTLB-load-misses -o "$perf_output" "$exe_path" "$input_file" "$min_support" "$output_file" "${extra_args[@]}"
             echo "✓ $exe_name completed - perf results saved to $perf_output"
         else
             # Fallback to basic timing
             echo "# Fallback timing benchmark for $exe_name" > "$perf_output"
             start_time=$(date +%s.%N)
-            "$exe_path" "$input_file" "$min_support" "$output_file"
+            "$exe_path" "$input_file" "$min_support" "$output_file" "${extra_args[@]}"
             end_time=$(date +%s.%N)
             execution_time=$(echo "$end_time - $start_time" | bc -l)
             echo "     ${execution_time} seconds time elapsed" >> "$perf_output"
@@ -189,7 +191,8 @@ for dataset in "${!test_configs[@]}"; do
         "$input_file" \
         "$min_support" \
         "$OUTPUT_DIR/${base_name}_pfp_${timestamp}.txt" \
-        "$PERF_OUTPUT_DIR/${base_name}_pfp_${timestamp}_perf.txt"
+        "$PERF_OUTPUT_DIR/${base_name}_pfp_${timestamp}_perf.txt" \
+        "${PFP_ARGS[@]}"
     
     # Benchmark UPMEM implementation (if available)
     if [ -f "$UPMEM_EXE" ]; then
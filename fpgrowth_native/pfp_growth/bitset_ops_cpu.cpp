@@ -0,0 +1,143 @@
+#include <cstdint>
+#include <cstddef>
+#include <immintrin.h>
+#include "include/bitset_ops_cpu.h"
+
+// Tidset intersection kernels for the Eclat engine.
+// The widest kernel supported by the running CPU is picked on first use.
+
+//---------------------------------------
+// Scalar
+static uint64_t and_popcount_scalar(const uint64_t* a, const uint64_t* b, uint64_t* out, size_t n) {
+    uint64_t count = 0;
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = a[i] & b[i];
+        count += __builtin_popcountll(out[i]);
+    }
+    return count;
+}
+
+static uint64_t andnot_popcount_scalar(const uint64_t* a, const uint64_t* b, uint64_t* out, size_t n) {
+    uint64_t count = 0;
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = a[i] & ~b[i];
+        count += __builtin_popcountll(out[i]);
+    }
+    return count;
+}
+//---------------------------------------
+
+//---------------------------------------
+// AVX2 (nibble lookup popcount, Mula et al.)
+__attribute__((target("avx2")))
+static inline __m256i popcount_avx2(__m256i v) {
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_mask = _mm256_set1_epi8(0x0f);
+    __m256i lo = _mm256_and_si256(v, low_mask);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+    __m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo), _mm256_shuffle_epi8(lookup, hi));
+    return _mm256_sad_epu8(cnt, _mm256_setzero_si256());
+}
+
+__attribute__((target("avx2")))
+static inline uint64_t reduce_avx2(__m256i acc) {
+    return (uint64_t)_mm256_extract_epi64(acc, 0) + (uint64_t)_mm256_extract_epi64(acc, 1)
+         + (uint64_t)_mm256_extract_epi64(acc, 2) + (uint64_t)_mm256_extract_epi64(acc, 3);
+}
+
+__attribute__((target("avx2")))
+static uint64_t and_popcount_avx2(const uint64_t* a, const uint64_t* b, uint64_t* out, size_t n) {
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i*)(b + i));
+        __m256i v = _mm256_and_si256(va, vb);
+        _mm256_storeu_si256((__m256i*)(out + i), v);
+        acc = _mm256_add_epi64(acc, popcount_avx2(v));
+    }
+    return reduce_avx2(acc) + and_popcount_scalar(a + i, b + i, out + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static uint64_t andnot_popcount_avx2(const uint64_t* a, const uint64_t* b, uint64_t* out, size_t n) {
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i*)(b + i));
+        __m256i v = _mm256_andnot_si256(vb, va);
+        _mm256_storeu_si256((__m256i*)(out + i), v);
+        acc = _mm256_add_epi64(acc, popcount_avx2(v));
+    }
+    return reduce_avx2(acc) + andnot_popcount_scalar(a + i, b + i, out + i, n - i);
+}
+//---------------------------------------
+
+//---------------------------------------
+// AVX-512 (VPOPCNTDQ)
+__attribute__((target("avx512f,avx512vpopcntdq")))
+static uint64_t and_popcount_avx512(const uint64_t* a, const uint64_t* b, uint64_t* out, size_t n) {
+    __m512i acc = _mm512_setzero_si512();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m512i va = _mm512_loadu_si512((const void*)(a + i));
+        __m512i vb = _mm512_loadu_si512((const void*)(b + i));
+        __m512i v = _mm512_and_si512(va, vb);
+        _mm512_storeu_si512((void*)(out + i), v);
+        acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(v));
+    }
+    return (uint64_t)_mm512_reduce_add_epi64(acc) + and_popcount_scalar(a + i, b + i, out + i, n - i);
+}
+
+__attribute__((target("avx512f,avx512vpopcntdq")))
+static uint64_t andnot_popcount_avx512(const uint64_t* a, const uint64_t* b, uint64_t* out, size_t n) {
+    __m512i acc = _mm512_setzero_si512();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m512i va = _mm512_loadu_si512((const void*)(a + i));
+        __m512i vb = _mm512_loadu_si512((const void*)(b + i));
+        __m512i v = _mm512_andnot_si512(vb, va);
+        _mm512_storeu_si512((void*)(out + i), v);
+        acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(v));
+    }
+    return (uint64_t)_mm512_reduce_add_epi64(acc) + andnot_popcount_scalar(a + i, b + i, out + i, n - i);
+}
+//---------------------------------------
+
+typedef uint64_t (*bitset_kernel_t)(const uint64_t*, const uint64_t*, uint64_t*, size_t);
+
+struct BitsetKernels {
+    bitset_kernel_t and_popcount;
+    bitset_kernel_t andnot_popcount;
+    const char* name;
+};
+
+static BitsetKernels select_kernels() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vpopcntdq")) {
+        return {and_popcount_avx512, andnot_popcount_avx512, "avx512"};
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return {and_popcount_avx2, andnot_popcount_avx2, "avx2"};
+    }
+    return {and_popcount_scalar, andnot_popcount_scalar, "scalar"};
+}
+
+static const BitsetKernels& kernels() {
+    static const BitsetKernels selected = select_kernels();
+    return selected;
+}
+
+uint64_t and_popcount(const uint64_t* a, const uint64_t* b, uint64_t* out, size_t nr_words) {
+    return kernels().and_popcount(a, b, out, nr_words);
+}
+
+uint64_t andnot_popcount(const uint64_t* a, const uint64_t* b, uint64_t* out, size_t nr_words) {
+    return kernels().andnot_popcount(a, b, out, nr_words);
+}
+
+const char* bitset_kernel_name() {
+    return kernels().name;
+}
@@ -7,6 +7,7 @@
 
 #include "include/param.h"
 #include "include/db_count_item_cpu.h"
+#include "include/thread_pool.h"
 
 #define MAX_ELEMS (MRAM_AVAILABLE / sizeof(int32_t))
 
@@ -81,18 +82,21 @@ std::vector<std::pair<int, int>> Database::scan_for_frequent_items(int min_suppo
 
     std::vector<std::pair<int, int>> frequent_items;
     seek_to_start();
-    // CPU version: use std::thread for parallel histogram counting
-    int num_threads = std::thread::hardware_concurrency();
-    if (num_threads == 0) num_threads = 4;
+    // CPU version: parallel histogram counting on the thread pool
+    int num_threads = ThreadPool::instance().size();
     std::vector<int32_t> flat_buffer;
     std::string line;
+    _nr_transactions = 0;
     while (std::getline(_file, line)) {
         std::istringstream iss(line);
         int item;
+        size_t prev_size = flat_buffer.size();
         while (iss >> item) {
             flat_buffer.push_back(item);
         }
+        if (flat_buffer.size() > prev_size) _nr_transactions++;
     }
+    _nr_item_occurrences = flat_buffer.size();
     std::vector<uint32_t> histogram(NR_DB_ITEMS, 0);
     cpu_count_items(flat_buffer, histogram, flat_buffer.size(), num_threads);
     for (int i = 0; i < NR_DB_ITEMS; i++) {
@@ -110,35 +114,32 @@ std::vector<std::pair<int, int>> Database::scan_for_frequent_items(int min_suppo
 
 std::deque<std::vector<int>> Database::filtered_items() {
 
-    std::vector<std::deque<std::vector<int>>> all_results(NR_THREADS);
-    std::vector<std::pair<std::streampos, std::streampos>> parts = divide_file(_file, NR_THREADS);
-    std::vector<std::thread> threads;
-
-    for (int i = 0; i < NR_THREADS; i++) {
-        threads.emplace_back([this, i, &parts, &all_results]() {
-            std::ifstream thread_file(_file_path); // Open a separate file stream for each thread
-            thread_file.seekg(parts[i].first);
-            std::string line;
-            while (thread_file.tellg() < parts[i].second && std::getline(thread_file, line)) {
-                //if(thread_file.eof()) break; // Check for end of file
-                std::istringstream iss(line);
-                std::vector<int> items;
-                int item;
-                while (iss >> item) {
-                    if (_item_count[item] >= _min_support) {
-                        items.push_back(item);
-                    }
-                }
-                if (!items.empty()) {
-                    std::sort(items.begin(), items.end(), [this](int a, int b) {
-                        return _item_priority[a] > _item_priority[b];
-                    });
-                    all_results[i].push_back(items);
+    // A small file splits into fewer parts than there are threads
+    std::vector<std::pair<std::streampos, std::streampos>> parts = divide_file(_file, ThreadPool::instance().size());
+    std::vector<std::deque<std::vector<int>>> all_results(parts.size());
+
+    ThreadPool::instance().parallel_for(parts.size(), [this, &parts, &all_results](int i) {
+        std::ifstream thread_file(_file_path); // Open a separate file stream for each thread
+        thread_file.seekg(parts[i].first);
+        std::string line;
+        while (thread_file.tellg() < parts[i].second && std::getline(thread_file, line)) {
+            //if(thread_file.eof()) break; // Check for end of file
+            std::istringstream iss(line);
+            std::vector<int> items;
+            int item;
+            while (iss >> item) {
+                if (_item_count[item] >= _min_support) {
+                    items.push_back(item);
                 }
             }
-        });
-    }
-    for (auto& t : threads) t.join();
+            if (!items.empty()) {
+                std::sort(items.begin(), items.end(), [this](int a, int b) {
+                    return _item_priority[a] > _item_priority[b];
+                });
+                all_results[i].push_back(items);
+            }
+        }
+    });
     // Combine results from all threads
     std::deque<std::vector<int>> results;
     for (const auto& result : all_results) {
@@ -155,4 +156,32 @@ std::deque<std::vector<int>> Database::filtered_items() {
     }
     #endif
     return results;
+}
+
+// Filtered and sorted first nr_samples transactions, used for cheap dataset statistics
+// Every stride-th transaction, so files sorted by length or time are sampled across their whole range
+std::vector<std::vector<int>> Database::sample_filtered_items(size_t nr_samples) {
+    seek_to_start();
+    std::vector<std::vector<int>> results;
+    std::string line;
+    size_t stride = std::max<size_t>(1, (_nr_transactions + nr_samples - 1) / std::max<size_t>(1, nr_samples));
+    for (size_t i = 0; results.size() < nr_samples && std::getline(_file, line); ++i) {
+        if (i % stride != 0) continue;
+        std::istringstream iss(line);
+        std::vector<int> items;
+        int item;
+        while (iss >> item) {
+            if (_item_count[item] >= _min_support) {
+                items.push_back(item);
+            }
+        }
+        if (!items.empty()) {
+            std::sort(items.begin(), items.end(), [this](int a, int b) {
+                return _item_priority[a] > _item_priority[b];
+            });
+            results.push_back(items);
+        }
+    }
+    seek_to_start();
+    return results;
 }
\ No newline at end of file
@@ -5,9 +5,10 @@
 #include <algorithm>
 #include "include/param.h"
 #include "include/db_count_item_cpu.h"
+#include "include/thread_pool.h"
 
 // CPU version of DPU db_count_item.c
-// Parallel histogram counting using std::thread
+// Parallel histogram counting on the shared thread pool
 void cpu_count_items(const std::vector<int32_t>& buffer, std::vector<uint32_t>& histogram, uint32_t count, int num_threads) {
     std::vector<std::vector<uint32_t>> local_hists(num_threads, std::vector<uint32_t>(NR_DB_ITEMS, 0));
     uint32_t stride = (count + num_threads - 1) / num_threads;
@@ -21,11 +22,7 @@ void cpu_count_items(const std::vector<int32_t>& buffer, std::vector<uint32_t>&
             }
         }
     };
-    std::vector<std::thread> threads;
-    for (int t = 0; t < num_threads; ++t) {
-        threads.emplace_back(worker, t);
-    }
-    for (auto& th : threads) th.join();
+    ThreadPool::instance().parallel_for(num_threads, worker);
     // Reduce local histograms
     std::fill(histogram.begin(), histogram.end(), 0);
     for (int t = 0; t < num_threads; ++t) {
@@ -0,0 +1,200 @@
+#include "include/eclat.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+#include "include/bitset_ops_cpu.h"
+#include "include/thread_pool.h"
+#include "include/timer.h"
+
+// Drop leading/trailing zero words so that later intersections only touch the populated range
+static void trim(Bitset& set) {
+    size_t first = 0;
+    size_t last = set.words.size();
+    while (first < last && set.words[first] == 0) first++;
+    while (last > first && set.words[last - 1] == 0) last--;
+    if (first > 0 || last < set.words.size()) {
+        set.words.erase(set.words.begin() + last, set.words.end());
+        set.words.erase(set.words.begin(), set.words.begin() + first);
+        set.begin += first;
+    }
+    if (set.words.empty()) set.begin = 0;
+}
+
+// out = a & b
+static uint32_t intersect(const Bitset& a, const Bitset& b, Bitset& out) {
+    uint32_t lo = std::max(a.begin, b.begin);
+    uint32_t hi = std::min(a.end(), b.end());
+    out.words.clear();
+    out.begin = 0;
+    if (lo >= hi) return 0;
+
+    out.begin = lo;
+    out.words.resize(hi - lo);
+    uint64_t count = and_popcount(a.words.data() + (lo - a.begin), b.words.data() + (lo - b.begin), out.words.data(), hi - lo);
+    trim(out);
+    return static_cast<uint32_t>(count);
+}
+
+// out = a & ~b
+static uint32_t difference(const Bitset& a, const Bitset& b, Bitset& out) {
+    out.begin = a.begin;
+    out.words.assign(a.words.begin(), a.words.end());
+    if (a.words.empty()) return 0;
+
+    uint64_t count = 0;
+    uint32_t lo = std::max(a.begin, b.begin);
+    uint32_t hi = std::min(a.end(), b.end());
+    if (lo < hi) {
+        uint64_t* overlap = out.words.data() + (lo - a.begin);
+        count += andnot_popcount(overlap, b.words.data() + (lo - b.begin), overlap, hi - lo);
+    } else {
+        lo = hi = a.begin;
+    }
+    for (uint32_t w = a.begin; w < lo; ++w) count += __builtin_popcountll(out.words[w - a.begin]);
+    for (uint32_t w = std::max(hi, a.begin); w < a.end(); ++w) count += __builtin_popcountll(out.words[w - a.begin]);
+    trim(out);
+    return static_cast<uint32_t>(count);
+}
+
+void Eclat::build_tidsets() {
+    Timer::instance().start("Scan for freq items");
+    std::vector<std::pair<int, int>> frequent_items = _db->scan_for_frequent_items(_min_support);
+    Timer::instance().stop();
+
+    build_tidsets(frequent_items);
+}
+
+void Eclat::build_tidsets(std::vector<std::pair<int, int>> frequent_items) {
+    Timer::instance().start("Eclat - Build Tidsets");
+    // Ascending support keeps the equivalence classes small near the root
+    std::sort(frequent_items.begin(), frequent_items.end(), [](const auto& a, const auto& b) {
+        return a.second < b.second || (a.second == b.second && a.first < b.first);
+    });
+
+    _frequent_itemsets_1.clear();
+    _frequent_supports_1.clear();
+    _k1_nodes.clear();
+    std::unordered_map<int, uint32_t> item_rank;
+    for (const auto& item : frequent_items) {
+        item_rank[item.first] = _k1_nodes.size();
+        _frequent_itemsets_1.push_back({static_cast<uint32_t>(item.first), -1});
+        _frequent_supports_1.push_back(item.second);
+
+        EclatNode node;
+        node.item = item.first;
+        node.id = item.first;
+        node.support = item.second;
+        _k1_nodes.push_back(std::move(node));
+    }
+    Timer::instance().stop();
+
+    Timer::instance().start("Eclat - Filter & Sort");
+    _db->seek_to_start();
+    std::deque<std::vector<int>> items_list = _db->filtered_items();
+    Timer::instance().stop();
+
+    Timer::instance().start("Eclat - Build Tidsets");
+    _nr_transactions = items_list.size();
+    size_t nr_words = (_nr_transactions + 63) / 64;
+    for (auto& node : _k1_nodes) {
+        node.set.begin = 0;
+        node.set.words.assign(nr_words, 0);
+    }
+
+    uint32_t tid = 0;
+    for (const auto& items : items_list) {
+        for (int item : items) {
+            _k1_nodes[item_rank[item]].set.words[tid >> 6] |= 1ull << (tid & 63);
+        }
+        tid++;
+    }
+    if (_root_diffsets) {
+        // d(X) = T \ t(X), taken against the root class that contains every transaction
+        Bitset all;
+        all.words.assign(nr_words, ~0ull);
+        if (_nr_transactions % 64) all.words.back() = (1ull << (_nr_transactions % 64)) - 1;
+        for (auto& node : _k1_nodes) {
+            Bitset tidset = std::move(node.set);
+            difference(all, tidset, node.set);
+        }
+    } else {
+        for (auto& node : _k1_nodes) {
+            trim(node.set);
+        }
+    }
+    Timer::instance().stop();
+}
+
+// Build the equivalence class of nodes[idx] (all frequent nodes[idx] + nodes[j], j > idx) and recurse
+void Eclat::extend(const std::vector<EclatNode>& nodes, uint32_t idx, bool diffset, LocalResult& result) {
+    const EclatNode& prefix = nodes[idx];
+    std::vector<EclatNode> children;
+    std::vector<uint32_t> sources;
+    uint64_t tidset_size = 0;
+    uint64_t diffset_size = 0;
+
+    for (uint32_t j = idx + 1; j < nodes.size(); ++j) {
+        EclatNode child;
+        child.item = nodes[j].item;
+        if (!diffset) {
+            // t(PXY) = t(PX) & t(PY)
+            child.support = intersect(prefix.set, nodes[j].set, child.set);
+        } else {
+            // d(PXY) = d(PY) \ d(PX), sup(PXY) = sup(PX) - |d(PXY)|
+            child.support = prefix.support - difference(nodes[j].set, prefix.set, child.set);
+        }
+        if ((int)child.support < _min_support) continue;
+
+        child.id = result.add(prefix.id, child.item, child.support);
+        tidset_size += child.support;
+        diffset_size += prefix.support - child.support;
+        sources.push_back(j);
+        children.push_back(std::move(child));
+    }
+    if (children.empty()) return;
+
+    // Switch the class to diffsets once they are smaller than the tidsets
+    bool child_diffset = diffset;
+    if (!diffset && diffset_size < tidset_size) {
+        for (uint32_t c = 0; c < children.size(); ++c) {
+            // d(PXY) = t(PX) \ t(PY)
+            difference(prefix.set, nodes[sources[c]].set, children[c].set);
+        }
+        child_diffset = true;
+    }
+
+    mine_class(children, child_diffset, result);
+}
+
+void Eclat::mine_class(std::vector<EclatNode>& nodes, bool diffset, LocalResult& result) {
+    for (uint32_t i = 0; i < nodes.size(); ++i) {
+        extend(nodes, i, diffset, result);
+        // The class of nodes[i] is finished, its set is no longer needed by later siblings
+        std::vector<uint64_t>().swap(nodes[i].set.words);
+    }
+}
+
+void Eclat::mine_frequent_itemsets() {
+    Timer::instance().start("Eclat - Mine");
+    // Each top-level equivalence class is an independent task
+    std::vector<LocalResult> results(_k1_nodes.size());
+    ThreadPool::instance().parallel_for(_k1_nodes.size(), [this, &results](int idx) {
+        extend(_k1_nodes, idx, _root_diffsets, results[idx]);
+    });
+    Timer::instance().stop();
+
+    Timer::instance().start("Eclat - Merge Results");
+    // Rebase local itemset ids onto the global id space
+    _frequent_itemsets_gt1.clear();
+    _frequent_supports_gt1.clear();
+    for (const auto& result : results) {
+        uint32_t offset = _frequent_itemsets_gt1.size();
+        for (auto [prefix_id, suffix_item] : result.itemsets) {
+            if (prefix_id >= NR_DB_ITEMS) prefix_id += offset;
+            _frequent_itemsets_gt1.push_back({prefix_id, suffix_item});
+        }
+        _frequent_supports_gt1.insert(_frequent_supports_gt1.end(), result.supports.begin(), result.supports.end());
+    }
+    Timer::instance().stop();
+}
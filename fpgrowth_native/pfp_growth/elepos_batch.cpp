@@ -0,0 +1,129 @@
+#include "include/elepos_batch.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <unistd.h>
+
+struct SpilledElePos {
+    uint32_t item;
+    uint32_t pos;
+    uint32_t support;
+};
+
+#define SPILL_CHUNK_ENTRIES (1 << 16)
+
+ElePosBatch::ElePosBatch(ElePosBatch&& other) noexcept
+    : _entries(std::move(other._entries)), _spilled_size(other._spilled_size), _path(std::move(other._path)) {
+    other._spilled_size = 0;
+    other._path.clear();
+}
+
+ElePosBatch& ElePosBatch::operator=(ElePosBatch&& other) noexcept {
+    if (this != &other) {
+        remove_file();
+        _entries = std::move(other._entries);
+        _spilled_size = other._spilled_size;
+        _path = std::move(other._path);
+        other._spilled_size = 0;
+        other._path.clear();
+    }
+    return *this;
+}
+
+ElePosBatch::~ElePosBatch() {
+    remove_file();
+}
+
+void ElePosBatch::remove_file() {
+    if (!_path.empty()) {
+        std::remove(_path.c_str());
+        _path.clear();
+    }
+}
+
+void ElePosBatch::spill(const std::string& dir) {
+    if (spilled()) return;
+
+    size_t size = _entries.size();
+    std::string path = dir + "/pfp_elepos_XXXXXX";
+    int fd = mkstemp(path.data());
+    if (fd < 0) {
+        throw std::runtime_error("Could not create spill file in: " + dir);
+    }
+    close(fd);
+
+    std::ofstream output(path, std::ios::binary);
+    std::vector<SpilledElePos> chunk;
+    chunk.reserve(std::min<size_t>(size, SPILL_CHUNK_ENTRIES));
+    for (size_t begin = 0; begin < size; begin += SPILL_CHUNK_ENTRIES) {
+        size_t end = std::min(size, begin + SPILL_CHUNK_ENTRIES);
+        chunk.clear();
+        for (size_t i = begin; i < end; ++i) {
+            chunk.push_back({_entries[i].item, _entries[i].pos, _entries[i].support});
+        }
+        output.write(reinterpret_cast<const char*>(chunk.data()), chunk.size() * sizeof(SpilledElePos));
+    }
+    if (!output) {
+        std::remove(path.c_str());
+        throw std::runtime_error("Could not write spill file: " + path);
+    }
+
+    _path = path;
+    _spilled_size = size;
+    std::vector<ElePosEntry>().swap(_entries);
+}
+
+ElePosEntry ElePosBatch::front() const {
+    if (!spilled()) return _entries.front();
+
+    std::ifstream input(_path, std::ios::binary);
+    SpilledElePos raw;
+    if (!input.read(reinterpret_cast<char*>(&raw), sizeof(raw))) {
+        throw std::runtime_error("Truncated spill file: " + _path);
+    }
+    return ElePosEntry {raw.item, raw.pos, raw.support, 0};
+}
+
+std::vector<ElePosEntry>& ElePosBatch::load() {
+    if (!spilled()) return _entries;
+
+    std::vector<ElePosEntry> entries;
+    entries.reserve(_spilled_size);
+    for_each_chunk(SPILL_CHUNK_ENTRIES, [&entries](const std::vector<ElePosEntry>& chunk, size_t begin, size_t end) {
+        entries.insert(entries.end(), chunk.begin() + begin, chunk.begin() + end);
+    });
+    _entries.swap(entries);
+    remove_file();
+    return _entries;
+}
+
+void ElePosBatch::for_each_chunk(size_t max_entries,
+                                 const std::function<void(const std::vector<ElePosEntry>&, size_t, size_t)>& fn) const {
+    if (!spilled()) {
+        for (size_t begin = 0; begin < _entries.size(); begin += max_entries) {
+            fn(_entries, begin, std::min(_entries.size(), begin + max_entries));
+        }
+        return;
+    }
+
+    std::ifstream input(_path, std::ios::binary);
+    if (!input.is_open()) {
+        throw std::runtime_error("Could not open file: " + _path);
+    }
+    std::vector<SpilledElePos> raw;
+    std::vector<ElePosEntry> chunk;
+    for (size_t begin = 0; begin < _spilled_size; begin += max_entries) {
+        size_t count = std::min(_spilled_size - begin, max_entries);
+        raw.resize(count);
+        if (!input.read(reinterpret_cast<char*>(raw.data()), count * sizeof(SpilledElePos))) {
+            throw std::runtime_error("Truncated spill file: " + _path);
+        }
+        chunk.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            chunk[i] = ElePosEntry {raw[i].item, raw[i].pos, raw[i].support, 0};
+        }
+        fn(chunk, 0, count);
+    }
+}
@@ -0,0 +1,108 @@
+#include "include/engine_select.h"
+
+#include <unordered_map>
+
+#include "include/common.h"
+#include "include/param.h"
+
+// Selection thresholds
+#define DENSE_DENSITY (0.25)            // Transactions hold at least a quarter of the frequent items
+#define SEMI_DENSE_DENSITY (0.10)
+#define POOR_COMPRESSION_RATIO (0.30)   // The tree keeps at least 30% of the item occurrences as nodes
+#define ROOT_DIFFSET_DENSITY (0.50)
+#define ECLAT_MAX_TIDSET_BYTES (2ull << 30)
+#define UPMEM_MIN_FP_ARRAY_BYTES (1ull << 20)
+
+DatasetStats collect_dataset_stats(Database& db, const std::vector<std::pair<int, int>>& frequent_items) {
+    DatasetStats stats = {};
+    stats.nr_transactions = db.get_nr_transactions();
+    stats.nr_item_occurrences = db.get_nr_item_occurrences();
+    stats.nr_frequent_items = frequent_items.size();
+
+    uint64_t frequent_occurrences = 0;
+    for (const auto& item : frequent_items) {
+        frequent_occurrences += item.second;
+    }
+    if (stats.nr_transactions > 0) {
+        stats.avg_transaction_len = (double)stats.nr_item_occurrences / stats.nr_transactions;
+        stats.avg_frequent_len = (double)frequent_occurrences / stats.nr_transactions;
+    }
+    if (stats.nr_frequent_items > 0) {
+        stats.density = stats.avg_frequent_len / stats.nr_frequent_items;
+    }
+
+    // Insert a sample into a throwaway prefix tree to estimate how well the FP-Tree compresses
+    std::vector<std::vector<int>> sample = db.sample_filtered_items(STATS_SAMPLE_TRANSACTIONS);
+    std::vector<std::unordered_map<int, uint32_t>> children(1);
+    uint64_t sampled_occurrences = 0;
+    for (const auto& items : sample) {
+        uint32_t node = 0;
+        for (int item : items) {
+            auto it = children[node].find(item);
+            if (it == children[node].end()) {
+                uint32_t child = children.size();
+                children[node][item] = child;
+                children.emplace_back();
+                node = child;
+            } else {
+                node = it->second;
+            }
+        }
+        sampled_occurrences += items.size();
+    }
+    stats.nr_sampled = sample.size();
+    stats.sample_nodes = children.size() - 1;
+    stats.compression_ratio = sampled_occurrences > 0 ? (double)stats.sample_nodes / sampled_occurrences : 0.0;
+
+    stats.est_fp_array_bytes = (uint64_t)(stats.compression_ratio * frequent_occurrences) * sizeof(FPArrayEntry);
+    stats.est_tidset_bytes = (uint64_t)stats.nr_frequent_items * ((stats.nr_transactions + 63) / 64) * sizeof(uint64_t);
+
+    return stats;
+}
+
+EngineChoice select_engine(const DatasetStats& stats, const std::string& upmem_bin) {
+    EngineChoice choice = {"fptree", false, ""};
+
+    if (stats.nr_frequent_items == 0) {
+        choice.reason = "no frequent items";
+        return choice;
+    }
+
+    bool dense = stats.density >= DENSE_DENSITY
+              || (stats.density >= SEMI_DENSE_DENSITY && stats.compression_ratio >= POOR_COMPRESSION_RATIO);
+    if (dense && stats.est_tidset_bytes <= ECLAT_MAX_TIDSET_BYTES) {
+        choice.engine = "eclat";
+        choice.eclat_root_diffsets = stats.density >= ROOT_DIFFSET_DENSITY;
+        choice.reason = stats.density >= DENSE_DENSITY ? "dense data" : "semi-dense data, FP-Tree would barely compress";
+        return choice;
+    }
+
+    // Root subtrees are not split, so an array that needs several shards may still not fit
+    uint64_t est_packed_bytes = stats.est_fp_array_bytes / sizeof(FPArrayEntry) * UPMEM_PACKED_ENTRY_SZ;
+    if (!upmem_bin.empty() && stats.est_fp_array_bytes >= UPMEM_MIN_FP_ARRAY_BYTES
+                           && est_packed_bytes <= UPMEM_DPU_FP_ARRAY_SZ * UPMEM_MAX_FP_ARRAY_SHARDS) {
+        choice.engine = "upmem";
+        choice.reason = est_packed_bytes <= UPMEM_DPU_FP_ARRAY_SZ ? "sparse data, FP-Array large enough to offload and fits in MRAM"
+                                                                   : "sparse data, FP-Array fits in MRAM when sharded over ranks";
+        return choice;
+    }
+
+    choice.reason = dense ? "dense data, but tidsets exceed the memory limit" : "sparse data, FP-Tree compresses well";
+    return choice;
+}
+
+void log_engine_selection(std::ostream& log, const DatasetStats& stats, const EngineChoice& choice) {
+    log << "[engine-select] transactions=" << stats.nr_transactions
+        << " avg_len=" << stats.avg_transaction_len
+        << " frequent_items=" << stats.nr_frequent_items
+        << " avg_frequent_len=" << stats.avg_frequent_len
+        << " density=" << stats.density
+        << " sampled=" << stats.nr_sampled
+        << " sample_nodes=" << stats.sample_nodes
+        << " compression=" << stats.compression_ratio
+        << " est_fp_array_bytes=" << stats.est_fp_array_bytes
+        << " est_tidset_bytes=" << stats.est_tidset_bytes << std::endl;
+    log << "[engine-select] engine=" << choice.engine
+        << " root_diffsets=" << choice.eclat_root_diffsets
+        << " reason=\"" << choice.reason << "\"" << std::endl;
+}
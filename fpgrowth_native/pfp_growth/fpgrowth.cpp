@@ -9,6 +9,7 @@
 #include <utility>
 
 #include "include/param.h"
+#include "include/thread_pool.h"
 #include "include/timer.h"
 
 void print_tree(Node* node, int depth = 0) {
@@ -31,14 +32,20 @@ void FPTree::build_tree() {
     std::vector<std::pair<int, int>> frequent_items = _db->scan_for_frequent_items(_min_support);
     Timer::instance().stop();
 
+    build_tree(frequent_items);
+}
+
+void FPTree::build_tree(std::vector<std::pair<int, int>> frequent_items) {
     Timer::instance().start("Build FP-Tree");
     std::sort(frequent_items.begin(), frequent_items.end(), [](const auto& a, const auto& b) {
         return a.second > b.second;
     });
 
     _frequent_itemsets_1.clear();
+    _frequent_supports_1.clear();
     for (const auto& item : frequent_items) {
         _frequent_itemsets_1.push_back({static_cast<uint32_t>(item.first), -1});
+        _frequent_supports_1.push_back(item.second);
     }
 
     _header_table.clear();
@@ -120,6 +127,17 @@ void FPTree::build_tree() {
 }
 
 void FPTree::build_fp_array() {
+    if (_layout == FPArrayLayout::Dfs) {
+        build_fp_array_dfs();
+    } else {
+        build_fp_array_leaf();
+    }
+    if (_use_path_runs) {
+        _path_runs = build_path_runs(_fp_array);
+    }
+}
+
+void FPTree::build_fp_array_leaf() {
     std::map<Node*, int> item_idx_table;
     _fp_array.clear();
 
@@ -147,6 +165,25 @@ void FPTree::build_fp_array() {
     }
 }
 
+// DFS preorder: a node follows its parent directly or after its earlier siblings'
+// subtrees, so short ancestor walks stay within a few cache lines
+void FPTree::build_fp_array_dfs() {
+    _fp_array.clear();
+
+    std::vector<std::pair<Node*, int32_t>> stack;
+    stack.push_back({_root, -1});
+    while (!stack.empty()) {
+        auto [node, parent_pos] = stack.back();
+        stack.pop_back();
+
+        int32_t pos = _fp_array.size();
+        _fp_array.push_back(FPArrayEntry {node->item, parent_pos, node->count, node->depth});
+        for (auto it = node->child.rbegin(); it != node->child.rend(); ++it) {
+            stack.push_back({*it, pos});
+        }
+    }
+}
+
 void FPTree::build_k1_ele_pos() {
     _k1_ele_pos.clear();
     
@@ -156,115 +193,366 @@ void FPTree::build_k1_ele_pos() {
     }
 }
 
-void FPTree::cpu_mine_candidates(const std::vector<ElePosEntry>& ele_pos, 
-                                 std::unordered_map<uint64_t, TempCandidates>& candidate_map) {
-    Timer::instance().start("Mine Freq Items - Preprocess");
-    // Distribute ElePos across Threads (Divide Ele Pos into chunks)
-    std::vector<std::vector<ElePosEntry>> distributed;
-    int quotent = ele_pos.size() / NR_THREADS;
-    int remainder = ele_pos.size() % NR_THREADS;
-    
-    int max_candidates = 0;
-    std::vector<int> candidate_cnts(NR_THREADS, 0);
-    for (int i = 0; i < NR_THREADS; ++i) {
-        int start = i * quotent + std::min(i, remainder);
-        int end = start + quotent + (i < remainder ? 1 : 0);
-        distributed.push_back(std::vector<ElePosEntry>(ele_pos.begin() + start, ele_pos.begin() + end));
-
-        // TODO: Consider this logic to be moved to the DPU code
-        int candidate_start_idx = 0;
-        for (int j = 0; j < (int)distributed.back().size(); ++j) {
-            distributed.back()[j].candidate_start_idx = candidate_start_idx;
-            if (distributed.back()[j].item == 0) continue;
-            candidate_start_idx += _fp_array[distributed.back()[j].pos].depth - 1;
-        }
-        candidate_cnts[i] = candidate_start_idx;
-        max_candidates = std::max(max_candidates, candidate_start_idx);
+// Split ele_pos[begin, end) into at most nr_parts ranges of similar candidate count, the
+// work of an entry is its depth - 1. A range holds at most max_entries entries, so the
+// returned range ends may stop short of end.
+std::vector<size_t> FPTree::split_by_depth(const std::vector<ElePosEntry>& ele_pos, size_t begin, size_t end,
+                                           size_t nr_parts, size_t max_entries) const {
+    uint64_t remaining = 0;
+    for (size_t i = begin; i < end; ++i) {
+        if (ele_pos[i].item != 0) remaining += _fp_array[ele_pos[i].pos].depth - 1;
     }
 
-    std::vector<std::vector<uint32_t>> counts(NR_THREADS, std::vector<uint32_t>(1, 0));
-    for (int i = 0; i < NR_THREADS; ++i) {
-        counts[i][0] = distributed[i].size();
-        int padding = distributed[0].size() - distributed[i].size();
-        if (padding > 0) {
-            distributed[i].resize(distributed[i].size() + padding, {0, 0, 0, 0}); // Pad with zeros
+    std::vector<size_t> ends;
+    size_t part_end = begin;
+    for (size_t part = 0; part < nr_parts && part_end < end; ++part) {
+        // Rebalance against what is left, earlier ranges may have been capped by max_entries
+        uint64_t target = (remaining + (nr_parts - part) - 1) / (nr_parts - part);
+        uint64_t weight = 0;
+        size_t part_begin = part_end;
+        while (part_end < end && part_end - part_begin < max_entries && (weight < target || part_end == part_begin)) {
+            const ElePosEntry& entry = ele_pos[part_end++];
+            if (entry.item != 0) weight += _fp_array[entry.pos].depth - 1;
         }
+        remaining -= weight;
+        ends.push_back(part_end);
     }
+    return ends;
+}
+
+void FPTree::cpu_count_candidates(const std::vector<ElePosEntry>& ele_pos, size_t begin, size_t end,
+                                  std::vector<CandidateTable>& candidate_tables) {
+    Timer::instance().start("Mine Freq Items - Preprocess");
+    ThreadPool& pool = ThreadPool::instance();
+    // More chunks than threads, the pool hands them out dynamically so deep chunks do not stall a level
+    std::vector<size_t> chunk_ends = split_by_depth(ele_pos, begin, end, pool.size() * ELEPOS_CHUNKS_PER_THREAD, end - begin);
+    int nr_chunks = chunk_ends.size();
+    int nr_partitions = candidate_tables.size();
+    _chunk_tables.resize(nr_chunks);
+    _candidate_buckets.resize(nr_chunks);
+    Timer::instance().stop();
+
+    Timer::instance().start("Mine Freq Items - Exec");
+    // Every chunk aggregates locally, repeated keys of one chunk leave it only once
+    pool.parallel_for(nr_chunks, [&](int c) {
+        CandidateTable& local_table = _chunk_tables[c];
+        local_table.clear();
+        count_candidates_worker(c == 0 ? begin : chunk_ends[c - 1], chunk_ends[c], ele_pos, _fp_array, _path_runs, _interleave, local_table);
+
+        auto& buckets = _candidate_buckets[c];
+        buckets.resize(nr_partitions);
+        for (auto& bucket : buckets) {
+            bucket.clear();
+        }
+        for (const auto& slot : local_table.slots()) {
+            if (slot.key == CANDIDATE_EMPTY_KEY) continue;
+            uint32_t prefix_item = CandidateTable::prefix_of(slot.key);
+            buckets[CandidateTable::partition_of(prefix_item, nr_partitions)].push_back(
+                CandidateEntry {prefix_item, CandidateTable::suffix_of(slot.key), 0, slot.support});
+        }
+    });
+    Timer::instance().stop();
+
+    Timer::instance().start("Mine Freq Items - Postprocess");
+    pool.parallel_for(nr_partitions, [&](int p) {
+        for (int c = 0; c < nr_chunks; ++c) {
+            for (const CandidateEntry& candidate : _candidate_buckets[c][p]) {
+                candidate_tables[p].add_support(CandidateTable::make_key(candidate.prefix_item, candidate.suffix_item), candidate.support);
+            }
+        }
+    });
+    Timer::instance().stop();
+}
+
+void FPTree::cpu_collect_candidates(const std::vector<ElePosEntry>& ele_pos, size_t begin, size_t end,
+                                    std::vector<CandidateTable>& candidate_tables) {
+    Timer::instance().start("Mine Freq Items - Preprocess");
+    ThreadPool& pool = ThreadPool::instance();
+    std::vector<size_t> chunk_ends = split_by_depth(ele_pos, begin, end, pool.size() * ELEPOS_CHUNKS_PER_THREAD, end - begin);
+    int nr_chunks = chunk_ends.size();
+    int nr_partitions = candidate_tables.size();
+    _candidate_buckets.resize(nr_chunks);
     Timer::instance().stop();
 
     Timer::instance().start("Mine Freq Items - Exec");
-    std::thread threads[NR_THREADS];
-    std::vector<std::vector<CandidateEntry>> candidates(NR_THREADS, std::vector<CandidateEntry>(max_candidates));
-    for (int i = 0; i < NR_THREADS; ++i) {
-        threads[i] = std::thread(mine_candidates_worker, i, NR_THREADS, std::ref(distributed[i]), std::ref(_fp_array), std::ref(candidates[i]));
+    pool.parallel_for(nr_chunks, [&](int c) {
+        auto& buckets = _candidate_buckets[c];
+        buckets.resize(nr_partitions);
+        for (auto& bucket : buckets) {
+            bucket.clear();
+        }
+        collect_candidates_worker(c == 0 ? begin : chunk_ends[c - 1], chunk_ends[c], ele_pos, _fp_array, _path_runs, _interleave,
+                                  candidate_tables, _min_support, buckets);
+    });
+    Timer::instance().stop();
+
+    Timer::instance().start("Mine Freq Items - Postprocess");
+    pool.parallel_for(nr_partitions, [&](int p) {
+        size_t nr_positions = 0;
+        for (int c = 0; c < nr_chunks; ++c) {
+            nr_positions += _candidate_buckets[c][p].size();
+        }
+        CandidateTable& candidate_table = candidate_tables[p];
+        candidate_table.reserve(nr_positions);
+        for (int c = 0; c < nr_chunks; ++c) {
+            for (const CandidateEntry& candidate : _candidate_buckets[c][p]) {
+                uint64_t key = CandidateTable::make_key(candidate.prefix_item, candidate.suffix_item);
+                candidate_table.add_position(key, candidate.suffix_item_pos, candidate.support);
+            }
+        }
+    });
+    Timer::instance().stop();
+}
+
+// Phase 1 of level 2 on a dense F x F matrix instead of the hash tables. Only the
+// frequent pairs enter candidate_tables, for phase 2 to collect their positions.
+// Threads count into private matrices, as many as the memory budget holds, or the last-level
+// cache without one. The threads left over share the first matrix through atomic adds.
+// Returns false if batch is not a level 1 batch, F is too large or not even one matrix fits the budget.
+bool FPTree::count_pairs_dense(const ElePosBatch& batch, std::vector<CandidateTable>& candidate_tables) {
+    uint32_t nr_items = _frequent_itemsets_1.size();
+    // Every batch holds a single level, itemset ids of level 2 and up start at NR_DB_ITEMS
+    if (batch.empty() || nr_items > DENSE_LEVEL2_MAX_ITEMS || batch.front().item >= NR_DB_ITEMS) return false;
+
+    ThreadPool& pool = ThreadPool::instance();
+    int nr_ranges = pool.size();
+    size_t matrix_size = (size_t)nr_items * nr_items;
+    size_t matrix_budget = _mem_budget > 0 ? _mem_budget : last_level_cache_bytes();
+    int nr_matrices = std::min<size_t>(nr_ranges, matrix_budget / (matrix_size * sizeof(uint32_t)));
+    if (nr_matrices == 0) {
+        if (_mem_budget > 0) return false;
+        nr_matrices = 1;
     }
-    for (int i = 0; i < NR_THREADS; ++i) {
-        threads[i].join();
+    bool shared = nr_matrices < nr_ranges;
+
+    Timer::instance().start("Mine Freq Items - Preprocess");
+    std::vector<int32_t> item_rank(NR_DB_ITEMS, -1);
+    for (uint32_t r = 0; r < nr_items; ++r) {
+        item_rank[_frequent_itemsets_1[r].first] = r;
     }
+    std::vector<std::vector<uint32_t>> matrices(nr_matrices);
+    matrices[0].resize(matrix_size, 0);
+    Timer::instance().stop();
+
+    Timer::instance().start("Mine Freq Items - Exec");
+    size_t max_elepos = (MRAM_FP_ELEPOS_SZ / sizeof(ElePosEntry)) * pool.size();
+    batch.for_each_chunk(max_elepos, [&](const std::vector<ElePosEntry>& ele_pos, size_t begin, size_t end) {
+        // One range per thread, ranges without a private matrix count into the shared first one
+        std::vector<size_t> ends = split_by_depth(ele_pos, begin, end, nr_ranges, end - begin);
+        pool.parallel_for(ends.size(), [&](int r) {
+            int m = r < nr_matrices ? r : 0;
+            if (m > 0) matrices[m].resize(matrix_size, 0);
+            count_pairs_worker(r == 0 ? begin : ends[r - 1], ends[r], ele_pos, _fp_array, _path_runs, _interleave,
+                               item_rank, nr_items, matrices[m].data(), m == 0 && shared);
+        });
+    });
     Timer::instance().stop();
 
     Timer::instance().start("Mine Freq Items - Postprocess");
-    //Merge Candidates
-    for (int i = 0; i < NR_THREADS; ++i) {
-        for (int j = 0; j < candidate_cnts[i]; ++j) {
-            const CandidateEntry& candidate = candidates[i][j];
-            if (candidate.suffix_item == 0) continue; // Skip root item
-            uint64_t key = (static_cast<uint64_t>(candidate.prefix_item) << 32) | candidate.suffix_item;
-            
-            auto it = candidate_map.try_emplace(key, candidate);
-            if (!it.second) {
-                it.first->second.add_candidate(candidate);
+    int nr_partitions = candidate_tables.size();
+    pool.parallel_for(nr_partitions, [&](int p) {
+        for (uint32_t a = 0; a < nr_items; ++a) {
+            uint32_t prefix_item = _frequent_itemsets_1[a].first;
+            if ((int)CandidateTable::partition_of(prefix_item, nr_partitions) != p) continue;
+            // Rows of a partition are only touched by its thread, sum them into the first matrix
+            uint32_t* row = matrices[0].data() + (size_t)a * nr_items;
+            for (int m = 1; m < nr_matrices; ++m) {
+                if (!matrices[m].empty()) add_pair_supports(row, matrices[m].data() + (size_t)a * nr_items, nr_items);
+            }
+            for (uint32_t b = 0; b < nr_items; ++b) {
+                uint32_t support = row[b];
+                if ((int)support < _min_support) continue;
+                uint64_t key = CandidateTable::make_key(prefix_item, _frequent_itemsets_1[b].first);
+                candidate_tables[p].add_support(key, support);
             }
         }
+    });
+    Timer::instance().stop();
+    return true;
+}
+
+void FPTree::mine_candidates(const ElePosBatch& batch, std::vector<CandidateTable>& candidate_tables) {
+    for (CandidateTable& candidate_table : candidate_tables) {
+        candidate_table.clear();
     }
+
+    ThreadPool& pool = ThreadPool::instance();
+    size_t max_elepos = (MRAM_FP_ELEPOS_SZ / sizeof(ElePosEntry)) * pool.size();
+    // Phase 1 only aggregates supports, phase 2 re-walks the ElePos and keeps the
+    // positions of frequent keys, so infrequent candidates are never stored
+    //Partition ElePos if too large, a spilled batch is streamed back one partition at a time
+    if (!count_pairs_dense(batch, candidate_tables)) {
+        batch.for_each_chunk(max_elepos, [&](const std::vector<ElePosEntry>& ele_pos, size_t begin, size_t end) {
+            cpu_count_candidates(ele_pos, begin, end, candidate_tables);
+        });
+    }
+    batch.for_each_chunk(max_elepos, [&](const std::vector<ElePosEntry>& ele_pos, size_t begin, size_t end) {
+        cpu_collect_candidates(ele_pos, begin, end, candidate_tables);
+    });
+
+    Timer::instance().start("Mine Freq Items - Postprocess");
+    pool.parallel_for(candidate_tables.size(), [&](int p) {
+        candidate_tables[p].finalize();
+    });
     Timer::instance().stop();
 }
 
-std::unordered_map<uint64_t, TempCandidates> FPTree::mine_candidates(const std::vector<ElePosEntry>& ele_pos) {
-    std::unordered_map<uint64_t, TempCandidates> candidate_map;
-    
-    int max_elepos = (MRAM_FP_ELEPOS_SZ / sizeof(ElePosEntry)) * NR_THREADS;
-    //Partition ElePos if too large
-    for (int partition = 0; partition < (int)ele_pos.size(); partition += max_elepos) {
-        int end = std::min(static_cast<int>(ele_pos.size()), partition + max_elepos);
-        std::vector<ElePosEntry> ele_pos_partition(ele_pos.begin() + partition, ele_pos.begin() + end);
-        cpu_mine_candidates(ele_pos_partition, candidate_map);
+// Upper bound of the candidates walked for ele_pos, every entry yields depth - 1 of them
+uint64_t FPTree::candidate_weight(const std::vector<ElePosEntry>& ele_pos) const {
+    uint64_t weight = 0;
+    for (const ElePosEntry& entry : ele_pos) {
+        if (entry.item != 0) weight += _fp_array[entry.pos].depth - 1;
+    }
+    return weight;
+}
+
+// Move the entries of the upper half of the itemset ids, by candidate weight, from batch to rest.
+// Candidate keys are partitioned by their prefix itemset, so both halves mine exactly
+// what the whole batch would have. Returns false if the batch holds a single itemset.
+bool FPTree::split_batch(std::vector<ElePosEntry>& batch, std::vector<ElePosEntry>& rest) const {
+    uint32_t min_id = UINT32_MAX, max_id = 0;
+    for (const ElePosEntry& entry : batch) {
+        if (entry.item == 0) continue;
+        min_id = std::min(min_id, entry.item);
+        max_id = std::max(max_id, entry.item);
+    }
+    if (min_id >= max_id) return false;
+
+    std::vector<uint64_t> id_weight(max_id - min_id + 1, 0);
+    uint64_t total = 0;
+    for (const ElePosEntry& entry : batch) {
+        if (entry.item == 0) continue;
+        id_weight[entry.item - min_id] += _fp_array[entry.pos].depth - 1;
+        total += _fp_array[entry.pos].depth - 1;
+    }
+    uint32_t split_id = min_id + 1;
+    uint64_t weight = id_weight[0];
+    while (split_id < max_id && weight + id_weight[split_id - min_id] <= total / 2) {
+        weight += id_weight[split_id++ - min_id];
     }
 
-    return candidate_map;
+    rest.clear();
+    size_t kept = 0;
+    for (const ElePosEntry& entry : batch) {
+        if (entry.item >= split_id) {
+            rest.push_back(entry);
+        } else {
+            batch[kept++] = entry;
+        }
+    }
+    batch.resize(kept);
+    return true;
 }
 
-void FPTree::mine_frequent_itemsets() {
-    std::vector<ElePosEntry> ele_pos = _k1_ele_pos;
-    while (ele_pos.size() > 0) {
-        //Mine Candidate
-        auto candidates = std::move(mine_candidates(ele_pos));
+void FPTree::mine_batch(const ElePosBatch& batch, std::vector<CandidateTable>& candidates,
+                        std::vector<ElePosEntry>& next_ele_pos) {
+    ThreadPool& pool = ThreadPool::instance();
+    int nr_partitions = candidates.size();
+
+    //Mine Candidate
+    mine_candidates(batch, candidates);
+
+    Timer::instance().start("Mine Freq Items - Merge Results");
+    // Count the frequent itemsets and next ElePos of every partition,
+    // the prefix sums give each partition its own id and output range
+    std::vector<uint32_t> itemset_base(nr_partitions + 1, 0);
+    std::vector<size_t> ele_pos_base(nr_partitions + 1, 0);
+    pool.parallel_for(nr_partitions, [&](int p) {
+        for (const auto& slot : candidates[p].slots()) {
+            if (slot.key == CANDIDATE_EMPTY_KEY || (int)slot.support < _min_support) continue;
+            itemset_base[p + 1]++;
+            ele_pos_base[p + 1] += slot.count;
+        }
+    });
+    for (int p = 0; p < nr_partitions; ++p) {
+        itemset_base[p + 1] += itemset_base[p];
+        ele_pos_base[p + 1] += ele_pos_base[p];
+    }
 
-        Timer::instance().start("Mine Freq Items - Merge Results");
-        std::vector<ElePosEntry> next_ele_pos;
-        for (const auto& [key, candidate_set] : candidates) {
-            if ((int)candidate_set.get_support() >= _min_support) {
-                //Save K+1 Frequent Itemset
-                uint32_t prefix_item = candidate_set.get_prefix_item();
-                _frequent_itemsets_gt1.push_back({prefix_item, candidate_set.get_suffix_item()});
-
-                //Create K+1 ElePos
-                uint32_t itemset_id = _itemset_id++;
-                for (const auto& candidate : candidate_set.candidates) {
-                    next_ele_pos.push_back(ElePosEntry {
-                        itemset_id,
-                        candidate.suffix_item_pos,
-                        candidate.support,
-                        0
-                    });
-                }
+    size_t first_itemset = _frequent_itemsets_gt1.size();
+    _frequent_itemsets_gt1.resize(first_itemset + itemset_base[nr_partitions]);
+    _frequent_supports_gt1.resize(first_itemset + itemset_base[nr_partitions]);
+    next_ele_pos.resize(ele_pos_base[nr_partitions]);
+    pool.parallel_for(nr_partitions, [&](int p) {
+        uint32_t itemset_idx = itemset_base[p];
+        size_t out = ele_pos_base[p];
+        for (const auto& slot : candidates[p].slots()) {
+            if (slot.key == CANDIDATE_EMPTY_KEY || (int)slot.support < _min_support) continue;
+            //Save K+1 Frequent Itemset
+            _frequent_itemsets_gt1[first_itemset + itemset_idx] = {CandidateTable::prefix_of(slot.key), CandidateTable::suffix_of(slot.key)};
+            _frequent_supports_gt1[first_itemset + itemset_idx] = slot.support;
+
+            //Create K+1 ElePos
+            uint32_t itemset_id = _itemset_id + itemset_idx++;
+            const CandidatePos* positions = candidates[p].positions(slot);
+            for (uint32_t i = 0; i < slot.count; ++i) {
+                next_ele_pos[out++] = ElePosEntry {
+                    itemset_id,
+                    positions[i].suffix_item_pos,
+                    positions[i].support,
+                    0
+                };
             }
         }
-        ele_pos.swap(next_ele_pos);
+    });
+    _itemset_id += itemset_base[nr_partitions];
+    Timer::instance().stop();
+}
+
+// Spill pending batches, the ones mined last first, until the in-memory ones fit the spill threshold
+void FPTree::spill_pending(std::vector<ElePosBatch>& pending) const {
+    if (_spill_threshold == 0) return;
+    size_t in_memory = 0;
+    for (const ElePosBatch& batch : pending) {
+        in_memory += batch.memory_bytes();
+    }
+    for (size_t i = 0; i < pending.size() && in_memory > _spill_threshold; ++i) {
+        if (pending[i].spilled() || pending[i].empty()) continue;
+        in_memory -= pending[i].memory_bytes();
+        Timer::instance().start("Mine Freq Items - Spill");
+        pending[i].spill(_spill_dir);
         Timer::instance().stop();
     }
 }
 
+void FPTree::mine_frequent_itemsets() {
+    ThreadPool& pool = ThreadPool::instance();
+    std::vector<CandidateTable> candidates(pool.size());
+
+    // Without a budget the stack holds one whole level at a time, which is the breadth-first order.
+    // A batch over budget is split by itemset id and its halves are mined depth-first,
+    // so only the split siblings stay pending instead of the whole next level.
+    // Pending batches beyond the spill threshold wait on disk.
+    std::vector<ElePosBatch> pending;
+    pending.emplace_back(std::vector<ElePosEntry>(_k1_ele_pos));
+    while (!pending.empty()) {
+        ElePosBatch batch = std::move(pending.back());
+        pending.pop_back();
+        if (batch.empty()) continue;
+
+        // A spilled batch larger than the spill threshold is mined straight from its file
+        bool fits = !batch.spilled() || _spill_threshold == 0 || batch.size() * sizeof(ElePosEntry) <= _spill_threshold;
+        if (_mem_budget > 0 && fits) {
+            std::vector<ElePosEntry>& entries = batch.load();
+            if (candidate_weight(entries) * CANDIDATE_FOOTPRINT > _mem_budget) {
+                std::vector<ElePosEntry> rest;
+                if (split_batch(entries, rest)) {
+                    pending.emplace_back(std::move(rest));
+                    pending.push_back(std::move(batch));
+                    spill_pending(pending);
+                    continue;
+                }
+            }
+        }
+
+        std::vector<ElePosEntry> next_ele_pos;
+        mine_batch(batch, candidates, next_ele_pos);
+        batch = ElePosBatch(std::vector<ElePosEntry>());
+        pending.emplace_back(std::move(next_ele_pos));
+        spill_pending(pending);
+    }
+}
+
 void FPTree::delete_tree(Node* node) {
     if (!node) return;
     
@@ -0,0 +1,16 @@
+#ifndef BITSET_OPS_CPU_H
+#define BITSET_OPS_CPU_H
+
+#include <cstddef>
+#include <cstdint>
+
+// out[i] = a[i] & b[i], returns popcount(out)
+uint64_t and_popcount(const uint64_t* a, const uint64_t* b, uint64_t* out, size_t nr_words);
+
+// out[i] = a[i] & ~b[i], returns popcount(out)
+uint64_t andnot_popcount(const uint64_t* a, const uint64_t* b, uint64_t* out, size_t nr_words);
+
+// Name of the kernel selected for this CPU ("avx512", "avx2" or "scalar")
+const char* bitset_kernel_name();
+
+#endif
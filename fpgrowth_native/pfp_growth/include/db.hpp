@@ -32,6 +32,10 @@ public:
     void seek_to_start();
     std::vector<std::pair<int, int>> scan_for_frequent_items(int min_support);
     std::deque<std::vector<int>> filtered_items();
+    std::vector<std::vector<int>> sample_filtered_items(size_t nr_samples);
+
+    uint32_t get_nr_transactions() const { return _nr_transactions; }
+    uint64_t get_nr_item_occurrences() const { return _nr_item_occurrences; }
 
 private:
     std::unordered_map<int, int> _item_priority = {};
@@ -39,6 +43,8 @@ private:
     std::ifstream _file;
     int _min_support;
     std::vector<int> _item_count;
+    uint32_t _nr_transactions = 0;
+    uint64_t _nr_item_occurrences = 0;
     // DPU methods removed for CPU build
 };
 
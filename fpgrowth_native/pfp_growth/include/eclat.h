@@ -0,0 +1,94 @@
+#ifndef ECLAT_H
+#define ECLAT_H
+
+#include <vector>
+#include <cstdint>
+
+#include "db.hpp"
+#include "param.h"
+
+// Vertical bitmap over transaction ids. Only words [begin, begin + words.size())
+// are stored; everything outside that range is zero.
+struct Bitset {
+    uint32_t begin;
+    std::vector<uint64_t> words;
+
+    Bitset(): begin(0) {}
+
+    uint32_t end() const {
+        return begin + static_cast<uint32_t>(words.size());
+    }
+};
+
+struct EclatNode {
+    uint32_t item;
+    uint32_t id;      // Itemset id (the item itself for 1-itemsets)
+    uint32_t support;
+    Bitset set;       // Tidset or diffset, depending on the equivalence class
+
+    EclatNode(): item(0), id(0), support(0) {}
+};
+
+// (dEclat) Vertical miner for dense datasets where the FP-Tree barely compresses.
+// Produces frequent itemsets in the same (prefix itemset id, suffix item) form as FPTree.
+class Eclat {
+public:
+    Eclat(int min_support, Database* db): _db(db), _min_support(min_support), _nr_transactions(0), _root_diffsets(false) {}
+
+    // Start from diffsets against the full transaction set (very dense data)
+    void set_root_diffsets(bool root_diffsets) { _root_diffsets = root_diffsets; }
+
+    void build_tidsets();
+    void build_tidsets(std::vector<std::pair<int, int>> frequent_items);
+    void mine_frequent_itemsets();
+
+    std::vector<std::pair<uint32_t, uint32_t>> get_frequent_itemsets() {
+        std::vector<std::pair<uint32_t, uint32_t>> frequent_itemsets(_frequent_itemsets_1.begin(), _frequent_itemsets_1.end());
+        frequent_itemsets.insert(frequent_itemsets.end(), _frequent_itemsets_gt1.begin(), _frequent_itemsets_gt1.end());
+
+        return frequent_itemsets;
+    }
+
+    const std::vector<std::pair<uint32_t, uint32_t>>& get_frequent_itemsets_1() const {
+        return _frequent_itemsets_1;
+    }
+
+    const std::vector<std::pair<uint32_t, uint32_t>>& get_frequent_itemsets_gt1() const {
+        return _frequent_itemsets_gt1;
+    }
+
+    const std::vector<uint32_t>& get_frequent_supports_1() const {
+        return _frequent_supports_1;
+    }
+
+    const std::vector<uint32_t>& get_frequent_supports_gt1() const {
+        return _frequent_supports_gt1;
+    }
+
+private:
+    struct LocalResult {
+        std::vector<std::pair<uint32_t, uint32_t>> itemsets; // prefix ids >= NR_DB_ITEMS are local
+        std::vector<uint32_t> supports;
+
+        uint32_t add(uint32_t prefix_id, uint32_t suffix_item, uint32_t support) {
+            itemsets.push_back({prefix_id, suffix_item});
+            supports.push_back(support);
+            return NR_DB_ITEMS + static_cast<uint32_t>(itemsets.size() - 1);
+        }
+    };
+
+    Database* _db;
+    int _min_support;
+    uint32_t _nr_transactions;
+    bool _root_diffsets;
+    std::vector<EclatNode> _k1_nodes; // Frequent items in ascending support order
+    std::vector<std::pair<uint32_t, uint32_t>> _frequent_itemsets_1;
+    std::vector<std::pair<uint32_t, uint32_t>> _frequent_itemsets_gt1;
+    std::vector<uint32_t> _frequent_supports_1;
+    std::vector<uint32_t> _frequent_supports_gt1;
+
+    void mine_class(std::vector<EclatNode>& nodes, bool diffset, LocalResult& result);
+    void extend(const std::vector<EclatNode>& nodes, uint32_t idx, bool diffset, LocalResult& result);
+};
+
+#endif
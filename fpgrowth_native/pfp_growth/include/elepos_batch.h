@@ -0,0 +1,49 @@
+#ifndef ELEPOS_BATCH_H
+#define ELEPOS_BATCH_H
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "common.h"
+
+// Pending batch of ElePos, held in memory or spilled to a temp file.
+// Spilled entries are stored as (item, pos, support), candidate_start_idx is not kept.
+class ElePosBatch {
+public:
+    explicit ElePosBatch(std::vector<ElePosEntry>&& entries): _entries(std::move(entries)), _spilled_size(0) {}
+    ElePosBatch(ElePosBatch&& other) noexcept;
+    ElePosBatch& operator=(ElePosBatch&& other) noexcept;
+    ElePosBatch(const ElePosBatch&) = delete;
+    ElePosBatch& operator=(const ElePosBatch&) = delete;
+    ~ElePosBatch();
+
+    size_t size() const { return spilled() ? _spilled_size : _entries.size(); }
+    bool empty() const { return size() == 0; }
+    bool spilled() const { return !_path.empty(); }
+    // Bytes held in memory
+    size_t memory_bytes() const { return _entries.capacity() * sizeof(ElePosEntry); }
+
+    // Write the entries to a temp file in dir and release their memory
+    void spill(const std::string& dir);
+    // First entry, read from the file if the batch is spilled. The batch must not be empty.
+    ElePosEntry front() const;
+    // Entries in memory, a spilled batch is read back first
+    std::vector<ElePosEntry>& load();
+
+    // Call fn(entries, begin, end) on consecutive ranges of at most max_entries entries.
+    // A spilled batch is streamed through one chunk buffer instead of being loaded.
+    void for_each_chunk(size_t max_entries,
+                        const std::function<void(const std::vector<ElePosEntry>&, size_t, size_t)>& fn) const;
+
+private:
+    std::vector<ElePosEntry> _entries;
+    size_t _spilled_size;
+    std::string _path;
+
+    void remove_file();
+};
+
+#endif
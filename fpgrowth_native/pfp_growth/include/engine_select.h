@@ -0,0 +1,39 @@
+#ifndef ENGINE_SELECT_H
+#define ENGINE_SELECT_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "db.hpp"
+
+#define STATS_SAMPLE_TRANSACTIONS (4096)
+
+// Cheap statistics collected right after the counting pass
+struct DatasetStats {
+    uint32_t nr_transactions;
+    uint64_t nr_item_occurrences;
+    double avg_transaction_len;
+    uint32_t nr_frequent_items;
+    double avg_frequent_len;     // Average transaction length after dropping infrequent items
+    double density;              // avg_frequent_len / nr_frequent_items
+    uint32_t nr_sampled;         // Transactions inserted into the sample tree, evenly strided over the file
+    uint64_t sample_nodes;
+    double compression_ratio;    // Sample tree nodes / sampled frequent item occurrences (1.0 = no sharing)
+    uint64_t est_fp_array_bytes;
+    uint64_t est_tidset_bytes;
+};
+
+struct EngineChoice {
+    std::string engine;          // "fptree", "eclat" or "upmem"
+    bool eclat_root_diffsets;
+    std::string reason;
+};
+
+DatasetStats collect_dataset_stats(Database& db, const std::vector<std::pair<int, int>>& frequent_items);
+EngineChoice select_engine(const DatasetStats& stats, const std::string& upmem_bin);
+void log_engine_selection(std::ostream& log, const DatasetStats& stats, const EngineChoice& choice);
+
+#endif
@@ -6,6 +6,9 @@
 
 #include "db.hpp"
 #include "common.h"
+#include "candidate_table.h"
+#include "elepos_batch.h"
+#include "mine_candidates_cpu.h"
 #include "param.h"
 
 struct Node {
@@ -27,37 +30,10 @@ struct HeaderTableEntry {
     std::list<Node*> node_link;
 };
 
-struct TempCandidates {
-private:
-    uint32_t support;
-    uint32_t prefix_item;
-    uint32_t suffix_item;
-
-public:
-    std::vector<CandidateEntry> candidates;
-
-    TempCandidates() : support(0), prefix_item(0), suffix_item(0) {}
-
-    TempCandidates(CandidateEntry first): support(first.support), prefix_item(first.prefix_item), suffix_item(first.suffix_item) {
-        candidates.push_back(first);
-    }
-
-    void add_candidate(const CandidateEntry& candidate) {
-        candidates.push_back(candidate);
-        support += candidate.support;
-    }
-
-    uint32_t get_support() const {
-        return support;
-    }
-
-    uint32_t get_prefix_item() const {
-        return prefix_item;
-    }
-
-    uint32_t get_suffix_item() const {
-        return suffix_item;
-    }
+// Order of the FP-array entries, see --layout
+enum class FPArrayLayout {
+    Leaf, // Each leaf, then its ancestors up to the first already placed node
+    Dfs   // Preorder from the root, ancestors sit close before their descendants
 };
 
 class FPTree {
@@ -82,14 +58,37 @@ public:
     }
 
     void build_tree();
+    void build_tree(std::vector<std::pair<int, int>> frequent_items);
     void build_fp_array();
+    void build_fp_array_leaf();
+    void build_fp_array_dfs();
     void build_k1_ele_pos();
-    void cpu_mine_candidates(const std::vector<ElePosEntry>& ele_pos, 
-                                 std::unordered_map<uint64_t, TempCandidates>& candidate_map);
+    std::vector<size_t> split_by_depth(const std::vector<ElePosEntry>& ele_pos, size_t begin, size_t end,
+                                       size_t nr_parts, size_t max_entries) const;
+    void cpu_count_candidates(const std::vector<ElePosEntry>& ele_pos, size_t begin, size_t end,
+                              std::vector<CandidateTable>& candidate_tables);
+    void cpu_collect_candidates(const std::vector<ElePosEntry>& ele_pos, size_t begin, size_t end,
+                                std::vector<CandidateTable>& candidate_tables);
+    uint64_t candidate_weight(const std::vector<ElePosEntry>& ele_pos) const;
+    bool split_batch(std::vector<ElePosEntry>& batch, std::vector<ElePosEntry>& rest) const;
+    void mine_batch(const ElePosBatch& batch, std::vector<CandidateTable>& candidates,
+                    std::vector<ElePosEntry>& next_ele_pos);
+    void spill_pending(std::vector<ElePosBatch>& pending) const;
+    bool count_pairs_dense(const ElePosBatch& batch, std::vector<CandidateTable>& candidate_tables);
     void mine_frequent_itemsets();
-    std::unordered_map<uint64_t, TempCandidates> mine_candidates(const std::vector<ElePosEntry>& ele_pos);
+    void mine_candidates(const ElePosBatch& batch, std::vector<CandidateTable>& candidate_tables);
     void delete_tree();
 
+    // Bytes a batch of ElePos may hold while it is mined, 0 mines whole levels breadth-first
+    void set_mem_budget(size_t bytes) { _mem_budget = bytes; }
+    void set_layout(FPArrayLayout layout) { _layout = layout; }
+    // Walk candidates over contiguous leaf-to-root runs instead of parent_pos, costs extra memory
+    void set_path_runs(bool enable) { _use_path_runs = enable; }
+    // Interleave the parent_pos walks over FP-arrays larger than the last-level cache
+    void set_interleave(bool enable) { _interleave = enable; }
+    // Pending ElePos over bytes in memory are written to temp files in dir, 0 never spills
+    void set_spill(size_t bytes, const std::string& dir) { _spill_threshold = bytes; _spill_dir = dir; }
+
     std::vector<std::pair<uint32_t, uint32_t>> get_frequent_itemsets() {
         std::vector<std::pair<uint32_t, uint32_t>> frequent_itemsets(_frequent_itemsets_1.begin(), _frequent_itemsets_1.end());
         frequent_itemsets.insert(frequent_itemsets.end(), _frequent_itemsets_gt1.begin(), _frequent_itemsets_gt1.end());
@@ -97,10 +96,22 @@ public:
         return frequent_itemsets;
     }
 
+    const std::vector<std::pair<uint32_t, uint32_t>>& get_frequent_itemsets_1() const {
+        return _frequent_itemsets_1;
+    }
+
     const std::vector<std::pair<uint32_t, uint32_t>>& get_frequent_itemsets_gt1() const {
         return _frequent_itemsets_gt1;
     }
 
+    const std::vector<uint32_t>& get_frequent_supports_1() const {
+        return _frequent_supports_1;
+    }
+
+    const std::vector<uint32_t>& get_frequent_supports_gt1() const {
+        return _frequent_supports_gt1;
+    }
+
 private:
     Node* _root; // Root item number is 0
     Node* _leaf_head;
@@ -111,7 +122,18 @@ private:
     std::vector<ElePosEntry> _k1_ele_pos;
     std::vector<std::pair<uint32_t, uint32_t>> _frequent_itemsets_1;
     std::vector<std::pair<uint32_t, uint32_t>> _frequent_itemsets_gt1;
+    std::vector<uint32_t> _frequent_supports_1;
+    std::vector<uint32_t> _frequent_supports_gt1;
     uint32_t _itemset_id = NR_DB_ITEMS;
+    size_t _mem_budget = 0;
+    FPArrayLayout _layout = FPArrayLayout::Leaf;
+    bool _use_path_runs = false;
+    PathRuns _path_runs;
+    bool _interleave = false;
+    size_t _spill_threshold = 0;
+    std::string _spill_dir;
+    std::vector<CandidateTable> _chunk_tables;                                 // Phase 1 per-chunk aggregation
+    std::vector<std::vector<std::vector<CandidateEntry>>> _candidate_buckets; // [chunk][partition], reused across calls
 
     void delete_tree(Node* node);
 };
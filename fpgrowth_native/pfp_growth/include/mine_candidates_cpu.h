@@ -4,10 +4,59 @@
 #include <vector>
 #include "param.h"
 #include "common.h"
+#include "candidate_table.h"
 
-void mine_candidates_worker(int thread_id, int num_threads, 
-                           const std::vector<ElePosEntry>& ele_pos,
-                           const std::vector<FPArrayEntry>& fp_array,
-                           std::vector<CandidateEntry>& candidates);
+// Leaf-to-root item runs of the FP-array, every node stored once. A run starts at a leaf
+// and climbs until the first node an earlier run already holds, then ends in a link entry
+// (item 0) whose position is the index of that node, or PATH_RUN_ROOT at the root.
+// The path of a node is a scan of its run that follows one link per branch point.
+#define PATH_RUN_ROOT UINT32_MAX
+struct PathRuns {
+    std::vector<uint32_t> items;     // Run entries, root excluded
+    std::vector<uint32_t> positions; // FP-array position of each entry, or index the link continues at
+    std::vector<uint32_t> offsets;   // Per FP-array entry, its own index in the runs
+
+    bool empty() const { return offsets.empty(); }
+};
+
+PathRuns build_path_runs(const std::vector<FPArrayEntry>& fp_array);
+
+// Phase 1: aggregate the support of every candidate of ele_pos[begin, end) into local_table.
+// Walks use paths when it is not empty, parent_pos otherwise, interleaved with interleave set
+// and an FP-array larger than the last-level cache.
+void count_candidates_worker(size_t begin, size_t end,
+                             const std::vector<ElePosEntry>& ele_pos,
+                             const std::vector<FPArrayEntry>& fp_array,
+                             const PathRuns& paths,
+                             bool interleave,
+                             CandidateTable& local_table);
+
+// Phase 2: re-walk ele_pos[begin, end) and keep only the candidates whose key is frequent,
+// bucketed by the partition of candidate_tables that owns their key
+void collect_candidates_worker(size_t begin, size_t end,
+                               const std::vector<ElePosEntry>& ele_pos,
+                               const std::vector<FPArrayEntry>& fp_array,
+                               const PathRuns& paths,
+                               bool interleave,
+                               const std::vector<CandidateTable>& candidate_tables,
+                               uint32_t min_support,
+                               std::vector<std::vector<CandidateEntry>>& buckets);
+
+// Level 2 without hashing: add the support of every (prefix, suffix) item pair of
+// ele_pos[begin, end) to pair_supports[rank(prefix) * nr_items + rank(suffix)],
+// with atomic adds when shared is set and other threads count into the same matrix
+void count_pairs_worker(size_t begin, size_t end,
+                        const std::vector<ElePosEntry>& ele_pos,
+                        const std::vector<FPArrayEntry>& fp_array,
+                        const PathRuns& paths,
+                        bool interleave,
+                        const std::vector<int32_t>& item_rank, uint32_t nr_items,
+                        uint32_t* pair_supports, bool shared);
+
+// Size of the L3 cache, or of the L2 without one
+size_t last_level_cache_bytes();
+
+// dst[i] += src[i], eight counts at a time where the CPU has AVX2
+void add_pair_supports(uint32_t* dst, const uint32_t* src, size_t n);
 
 #endif
@@ -22,12 +22,24 @@
 #define ALIGN_DOWN(BYTES, ALIGN) ((BYTES) - ((BYTES) % (ALIGN)))
 #define MRAM_AVAILABLE ALIGN_DOWN(MRAM_MAX - MRAM_RESERVED, 8)
 
+// FP-arrays the upmem_hist miner takes, see upmem_hist/include/param.h and mram_layout.h. It packs
+// entries into 8 bytes, keeps the smallest ElePos and candidate regions free on every DPU and
+// shards a larger array by root subtree over up to one shard per rank of 64 DPUs.
+#define UPMEM_PACKED_ENTRY_SZ (8)
+#define UPMEM_DPU_FP_ARRAY_SZ (ALIGN_DOWN(MRAM_MAX - MRAM_RESERVED, 8) - (512ull << 10) - (4ull << 20))
+#define UPMEM_MAX_FP_ARRAY_SHARDS (1024 / 64)
+
 #ifndef NR_DB_ITEMS
 #define NR_DB_ITEMS 1024
 #endif
 
 #define DPU_CONFIG "backend=simulator"
 
-#define NR_THREADS 4
+#define DEFAULT_NR_THREADS 4 // When hardware_concurrency() is unknown, see --threads
+#define ELEPOS_CHUNKS_PER_THREAD 8
+#define DENSE_LEVEL2_MAX_ITEMS 1024 // Level 2 is counted in F x F matrices, one per thread within --mem-budget or the last-level cache, up to this many frequent items
+#define WALK_GROUP_SIZE 8 // Interleaved ancestor walks per worker, hides FP-array misses
+#define WALK_INTERLEAVE_MIN_BYTES (32 << 20) // FP-array size from which --interleave applies when the cache size is unknown
+#define CANDIDATE_FOOTPRINT 64 // Bytes held per walked candidate while a batch is mined, see --mem-budget
 
 #endif
\ No newline at end of file
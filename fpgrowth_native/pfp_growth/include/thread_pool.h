@@ -0,0 +1,56 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Process-wide pool of persistent worker threads, shared by every stage.
+// The calling thread takes part in each job, so a pool of size N runs N - 1 workers.
+class ThreadPool {
+public:
+    static ThreadPool& instance() {
+        static ThreadPool pool_instance;
+        return pool_instance;
+    }
+
+    // nr_threads = 0 uses hardware_concurrency(). With pin, thread i is bound to core i.
+    void configure(int nr_threads, bool pin);
+    int size();
+
+    // Run fn(0) .. fn(n - 1) and return once all calls finished. Tasks are claimed
+    // dynamically, so uneven tasks balance out. Nested calls run inline.
+    void parallel_for(int n, const std::function<void(int)>& fn);
+
+private:
+    ThreadPool() = default;
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int _nr_threads = 0;
+    bool _pin = false;
+    std::vector<std::thread> _workers;
+
+    std::mutex _submit_mutex;           // One job at a time
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _done;
+    uint64_t _generation = 0;
+    bool _stop = false;
+    const std::function<void(int)>* _fn = nullptr;
+    int _nr_tasks = 0;
+    std::atomic<int> _next_task {0};
+    int _busy_workers = 0;
+
+    void start_workers();
+    void stop_workers();
+    void worker_loop(int worker_id, uint64_t seen);
+    void run_tasks();
+};
+
+#endif
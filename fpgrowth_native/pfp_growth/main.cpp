@@ -1,59 +1,261 @@
 
 #include "include/fpgrowth.h"
+#include "include/eclat.h"
+#include "include/engine_select.h"
+#include "itemset_trie.h"
+#include "include/thread_pool.h"
 #include "include/db.hpp"
 #include "include/timer.h"
 
 #include <iostream>
 #include <functional>
+#include <cstring>
+#include <filesystem>
+#include <unistd.h>
+#include <map>
+#include <set>
 
-int main(int argc, char* argv[]) {
-    if (argc < 4) {
-        printf("Usage: %s <data_file> <min_support> <output_file>\n", argv[0]);
-        return 1;
-    }
-    std::string db_path = argv[1];
-    int min_support = std::stoi(argv[2]);
-    std::string output_file = argv[3];
-    Database db(db_path.c_str());
-    FPTree fp_tree(min_support, &db);
-    fp_tree.build_tree();
-
-    Timer::instance().start("Build FP-Array");
-    fp_tree.build_fp_array();
-    Timer::instance().stop();
-
-    Timer::instance().start("Build K1 ElePos");
-    fp_tree.build_k1_ele_pos();
-    Timer::instance().stop();
-
-    fp_tree.mine_frequent_itemsets();
-
+template <typename Miner>
+void write_frequent_itemsets(Miner& miner, const std::string& output_file) {
     std::ofstream output(output_file);
-    std::function<void(uint32_t)> get_prefix = [&output, &fp_tree, &get_prefix](uint32_t item) {
+    std::function<void(uint32_t)> get_prefix = [&output, &miner, &get_prefix](uint32_t item) {
         if (item < NR_DB_ITEMS) {
             output << item << " ";
         } else {
-            const auto& prefix = fp_tree.get_frequent_itemsets_gt1()[item - NR_DB_ITEMS];
+            const auto& prefix = miner.get_frequent_itemsets_gt1()[item - NR_DB_ITEMS];
             get_prefix(prefix.first);
             if (prefix.second != (uint32_t)-1)
                 output << prefix.second << " ";
         }
     };
 
-    for (const auto& itemset : fp_tree.get_frequent_itemsets()) {
+    for (const auto& itemset : miner.get_frequent_itemsets()) {
         auto [first, second] = itemset;
         if (first < NR_DB_ITEMS) {
             output << first;
             if (second != (uint32_t)-1)
                 output << " " << second;
-            output << std::endl;
+            output << '\n';
         } else {
             get_prefix(first);
-            output << second << std::endl;
+            output << second << '\n';
         }
     }
+}
+
+template <typename Miner>
+void write_frequent_itemsets_trie(Miner& miner, const std::string& output_file) {
+    write_itemset_trie(output_file, NR_DB_ITEMS,
+                       miner.get_frequent_itemsets_1(), miner.get_frequent_supports_1(),
+                       miner.get_frequent_itemsets_gt1(), miner.get_frequent_supports_gt1());
+}
+
+template <typename Miner>
+void write_output(Miner& miner, const std::string& output_file, const std::string& output_format) {
+    Timer::instance().start("Write Output");
+    if (output_format == "trie") {
+        write_frequent_itemsets_trie(miner, output_file);
+    } else {
+        write_frequent_itemsets(miner, output_file);
+    }
+    Timer::instance().stop();
+}
+
+// Given engine options that engine does not use
+static std::vector<std::string> ignored_options(const std::string& engine, const std::vector<std::string>& given) {
+    static const std::map<std::string, std::set<std::string>> supported = {
+        {"fptree", {"--output-format", "--threads", "--pin", "--mem-budget", "--spill-threshold", "--spill-dir", "--layout", "--path-runs", "--interleave"}},
+        {"eclat", {"--output-format", "--threads", "--pin"}},
+        {"upmem", {"--output-format", "--mem-budget", "--layout"}},
+    };
+    std::vector<std::string> ignored;
+    auto it = supported.find(engine);
+    if (it == supported.end()) return ignored;
+    for (const std::string& option : given) {
+        if (!it->second.count(option)) ignored.push_back(option);
+    }
+    return ignored;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 4) {
+        printf("Usage: %s <data_file> <min_support> <output_file> [--engine auto|fptree|eclat|upmem] [--upmem-bin <path>] [--selection-log <path>] [--output-format text|trie] [--threads <n>] [--pin] [--mem-budget <MB>] [--spill-threshold <MB>] [--spill-dir <path>] [--layout leaf|dfs] [--path-runs] [--interleave]\n", argv[0]);
+        return 1;
+    }
+    std::string db_path = argv[1];
+    int min_support = std::stoi(argv[2]);
+    std::string output_file = argv[3];
+    std::string engine = "auto";
+    std::string upmem_bin;
+    std::string selection_log;
+    std::string output_format = "text";
+    int nr_threads = 0;
+    bool pin_threads = false;
+    size_t mem_budget_mb = 0;
+    size_t spill_threshold_mb = 0;
+    std::string spill_dir = std::filesystem::temp_directory_path().string();
+    FPArrayLayout layout = FPArrayLayout::Leaf;
+    bool path_runs = false;
+    bool interleave = false;
+    // Options handed on to the DPU binary, and the names of all given engine options
+    std::vector<std::string> upmem_args;
+    std::vector<std::string> given_options;
+    for (int i = 4; i < argc; ++i) {
+        if (strcmp(argv[i], "--engine") == 0 && i + 1 < argc) {
+            engine = argv[++i];
+        } else if (strcmp(argv[i], "--upmem-bin") == 0 && i + 1 < argc) {
+            upmem_bin = argv[++i];
+        } else if (strcmp(argv[i], "--selection-log") == 0 && i + 1 < argc) {
+            selection_log = argv[++i];
+        } else if (strcmp(argv[i], "--output-format") == 0 && i + 1 < argc) {
+            output_format = argv[++i];
+            if (output_format != "text" && output_format != "trie") {
+                printf("Unknown output format: %s\n", output_format.c_str());
+                return 1;
+            }
+            upmem_args.insert(upmem_args.end(), {argv[i - 1], argv[i]});
+            given_options.push_back(argv[i - 1]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            nr_threads = std::stoi(argv[++i]);
+            given_options.push_back(argv[i - 1]);
+        } else if (strcmp(argv[i], "--pin") == 0) {
+            pin_threads = true;
+            given_options.push_back(argv[i]);
+        } else if (strcmp(argv[i], "--mem-budget") == 0 && i + 1 < argc) {
+            mem_budget_mb = std::stoul(argv[++i]);
+            upmem_args.insert(upmem_args.end(), {argv[i - 1], argv[i]});
+            given_options.push_back(argv[i - 1]);
+        } else if (strcmp(argv[i], "--spill-threshold") == 0 && i + 1 < argc) {
+            spill_threshold_mb = std::stoul(argv[++i]);
+            given_options.push_back(argv[i - 1]);
+        } else if (strcmp(argv[i], "--spill-dir") == 0 && i + 1 < argc) {
+            spill_dir = argv[++i];
+            given_options.push_back(argv[i - 1]);
+            if (!std::filesystem::is_directory(spill_dir) || access(spill_dir.c_str(), W_OK | X_OK) != 0) {
+                printf("Spill directory is not a writable directory: %s\n", spill_dir.c_str());
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--layout") == 0 && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (name == "leaf") {
+                layout = FPArrayLayout::Leaf;
+            } else if (name == "dfs") {
+                layout = FPArrayLayout::Dfs;
+            } else {
+                printf("Unknown layout: %s\n", name.c_str());
+                return 1;
+            }
+            upmem_args.insert(upmem_args.end(), {argv[i - 1], argv[i]});
+            given_options.push_back(argv[i - 1]);
+        } else if (strcmp(argv[i], "--path-runs") == 0) {
+            path_runs = true;
+            given_options.push_back(argv[i]);
+        } else if (strcmp(argv[i], "--interleave") == 0) {
+            interleave = true;
+            given_options.push_back(argv[i]);
+        } else {
+            printf("Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+    }
+    ThreadPool::instance().configure(nr_threads, pin_threads);
+    Database db(db_path.c_str());
+
+    std::vector<std::pair<int, int>> frequent_items;
+    bool scanned = false;
+    bool eclat_root_diffsets = false;
+    bool auto_selected = engine == "auto";
+    if (auto_selected) {
+        Timer::instance().start("Scan for freq items");
+        frequent_items = db.scan_for_frequent_items(min_support);
+        Timer::instance().stop();
+        scanned = true;
+
+        Timer::instance().start("Engine Selection");
+        DatasetStats stats = collect_dataset_stats(db, frequent_items);
+        EngineChoice choice = select_engine(stats, upmem_bin);
+        Timer::instance().stop();
+
+        log_engine_selection(std::cout, stats, choice);
+        if (!selection_log.empty()) {
+            std::ofstream log(selection_log, std::ios::app);
+            log << "[engine-select] data=" << db_path << " min_support=" << min_support << std::endl;
+            log_engine_selection(log, stats, choice);
+        }
+        engine = choice.engine;
+        eclat_root_diffsets = choice.eclat_root_diffsets;
+    }
+
+    // An explicit upmem run refuses host options, otherwise they are only reported
+    std::vector<std::string> ignored = ignored_options(engine, given_options);
+    if (!ignored.empty() && engine == "upmem" && !auto_selected) {
+        printf("%s is not supported by the upmem engine\n", ignored.front().c_str());
+        return 1;
+    }
+    for (const std::string& option : ignored) {
+        printf("Warning: %s is ignored by the %s engine\n", option.c_str(), engine.c_str());
+    }
+
+    if (engine == "upmem") {
+        if (upmem_bin.empty()) {
+            printf("--engine upmem requires --upmem-bin <path>\n");
+            return 1;
+        }
+        // Hand the run over to the DPU binary, it does its own counting pass on the DPUs
+        std::cout << std::flush;
+        std::vector<char*> upmem_argv = {upmem_bin.data(), argv[1], argv[2], argv[3]};
+        for (std::string& arg : upmem_args) {
+            upmem_argv.push_back(arg.data());
+        }
+        upmem_argv.push_back(nullptr);
+        execv(upmem_bin.c_str(), upmem_argv.data());
+        perror("execv");
+        return 1;
+    } else if (engine == "eclat") {
+        Eclat eclat(min_support, &db);
+        eclat.set_root_diffsets(eclat_root_diffsets);
+        if (scanned) {
+            eclat.build_tidsets(frequent_items);
+        } else {
+            eclat.build_tidsets();
+        }
+        eclat.mine_frequent_itemsets();
+        write_output(eclat, output_file, output_format);
+    } else if (engine == "fptree") {
+        FPTree fp_tree(min_support, &db);
+        fp_tree.set_mem_budget(mem_budget_mb << 20);
+        fp_tree.set_spill(spill_threshold_mb << 20, spill_dir);
+        fp_tree.set_layout(layout);
+        fp_tree.set_path_runs(path_runs);
+        fp_tree.set_interleave(interleave);
+        if (scanned) {
+            fp_tree.build_tree(frequent_items);
+        } else {
+            fp_tree.build_tree();
+        }
+
+        Timer::instance().start("Build FP-Array");
+        fp_tree.build_fp_array();
+        Timer::instance().stop();
+
+        Timer::instance().start("Build K1 ElePos");
+        fp_tree.build_k1_ele_pos();
+        Timer::instance().stop();
+
+        // Spill files that cannot be created, written or read back end the run
+        try {
+            fp_tree.mine_frequent_itemsets();
+        } catch (const std::runtime_error& e) {
+            printf("Error: %s\n", e.what());
+            return 1;
+        }
+        write_output(fp_tree, output_file, output_format);
+    } else {
+        printf("Unknown engine: %s\n", engine.c_str());
+        return 1;
+    }
 
     Timer::instance().print_records();
-    
+
     return 0;
 }
\ No newline at end of file
@@ -1,8 +1,11 @@
 #include <vector>
 #include <thread>
 #include <cstdint>
+#include <unistd.h>
+#include <immintrin.h>
 #include "include/param.h"
 #include "include/common.h"
+#include "include/mine_candidates_cpu.h"
 
 //---------------------------------------
 // FP Growth structures
@@ -11,16 +14,45 @@ typedef struct FPArrayEntry fp_array_entry_t;
 typedef struct CandidateEntry candidate_entry_t;
 //---------------------------------------
 
-// Worker function for threaded candidate mining
+PathRuns build_path_runs(const std::vector<FPArrayEntry>& fp_array) {
+    PathRuns paths;
+    std::vector<uint8_t> has_child(fp_array.size(), 0);
+    for (const FPArrayEntry& entry : fp_array) {
+        if ((uint32_t)entry.parent_pos < fp_array.size()) has_child[entry.parent_pos] = 1;
+    }
+
+    // One run per leaf, holding only the nodes no earlier run reached
+    paths.offsets.assign(fp_array.size(), UINT32_MAX);
+    for (uint32_t leaf = 0; leaf < fp_array.size(); ++leaf) {
+        if (has_child[leaf] || fp_array[leaf].item == 0) continue;
+        uint32_t pos = leaf;
+        while (pos < fp_array.size() && fp_array[pos].item != 0 && paths.offsets[pos] == UINT32_MAX) {
+            paths.offsets[pos] = paths.items.size();
+            paths.items.push_back(fp_array[pos].item);
+            paths.positions.push_back(pos);
+            pos = fp_array[pos].parent_pos;
+        }
+        bool at_root = pos >= fp_array.size() || fp_array[pos].item == 0;
+        paths.items.push_back(0);
+        paths.positions.push_back(at_root ? PATH_RUN_ROOT : paths.offsets[pos]);
+    }
+    return paths;
+}
+
+size_t last_level_cache_bytes() {
+    long bytes = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if (bytes <= 0) bytes = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    return bytes > 0 ? bytes : WALK_INTERLEAVE_MIN_BYTES;
+}
+
+// Walk the ancestors of every ElePos in [begin, end) one after the other.
 // Simplified version matching DPU logic
-void mine_candidates_worker(int thread_id, int num_threads, 
-                           const std::vector<ElePosEntry>& ele_pos,
-                           const std::vector<FPArrayEntry>& fp_array,
-                           std::vector<CandidateEntry>& candidates) {
-    // Process ALL elements in ele_pos (which is already partitioned per-thread)
-    // Don't skip by num_threads - that's already done in the partitioning
-    for (int i = 0; i < (int)ele_pos.size(); i++) {
-        candidate_entry_t candidate;
+template <typename Emit>
+static inline void walk_sequential(size_t begin, size_t end,
+                                   const std::vector<ElePosEntry>& ele_pos,
+                                   const std::vector<FPArrayEntry>& fp_array,
+                                   Emit&& emit) {
+    for (size_t i = begin; i < end; i++) {
         elepos_entry_t entry;
         fp_array_entry_t fp_item;
         
@@ -40,19 +72,9 @@ void mine_candidates_worker(int thread_id, int num_threads,
         if (fp_item.parent_pos >= fp_array.size()) continue; // Bounds check
         fp_item = fp_array[fp_item.parent_pos];
         
-        int candidate_idx = 0;
         while (fp_item.item != 0) {
             // Create candidate itemsets
-            candidate.prefix_item = entry.item;
-            candidate.suffix_item = fp_item.item;
-            candidate.suffix_item_pos = suffix_idx;
-            candidate.support = entry.support;
-
-            // Write candidate to output
-            uint32_t out_idx = entry.candidate_start_idx + candidate_idx++;
-            if (out_idx < candidates.size()) {
-                candidates[out_idx] = candidate;
-            }
+            emit(entry.item, fp_item.item, suffix_idx, entry.support);
 
             // Get the next parent
             suffix_idx = fp_item.parent_pos;
@@ -61,3 +83,211 @@ void mine_candidates_worker(int thread_id, int num_threads,
         }
     }
 }
+
+// Same walks as walk_sequential(). Every ancestor step is a dependent load, so
+// WALK_GROUP_SIZE walks advance in round-robin and each prefetches its next parent
+// while the others use theirs.
+// A walk buffers its ancestors and emits them in one run once it reaches the root,
+// candidates of one prefix stay together for the table.
+template <typename Emit>
+static inline void walk_interleaved(size_t begin, size_t end,
+                                    const std::vector<ElePosEntry>& ele_pos,
+                                    const std::vector<FPArrayEntry>& fp_array,
+                                    Emit&& emit) {
+    struct Walk {
+        uint32_t prefix_item;
+        uint32_t support;
+        uint32_t pos;
+        std::vector<std::pair<uint32_t, uint32_t>> ancestors; // (item, suffix_item_pos)
+    };
+    Walk walks[WALK_GROUP_SIZE];
+    const fp_array_entry_t* fp = fp_array.data();
+    size_t fp_size = fp_array.size();
+    size_t next = begin;
+
+    // Start the next walk of ele_pos in walk, false once ele_pos is exhausted
+    auto start_walk = [&](Walk& walk) {
+        while (next < end) {
+            // Read ElePos Entry
+            elepos_entry_t entry = ele_pos[next++];
+            if (entry.item == 0) {
+                continue; // Skip if item is 0 (root)
+            }
+
+            // Get the corresponding FPArrayEntry
+            if (entry.pos >= fp_size) continue; // Bounds check
+            uint32_t parent_pos = fp[entry.pos].parent_pos;
+            if (parent_pos >= fp_size) continue; // Bounds check
+
+            walk.prefix_item = entry.item;
+            walk.support = entry.support;
+            walk.pos = parent_pos;
+            walk.ancestors.clear();
+            __builtin_prefetch(&fp[parent_pos]);
+            return true;
+        }
+        return false;
+    };
+
+    auto finish_walk = [&](const Walk& walk) {
+        for (const auto& [item, suffix_idx] : walk.ancestors) {
+            // Create candidate itemsets
+            emit(walk.prefix_item, item, suffix_idx, walk.support);
+        }
+    };
+
+    int nr_active = 0;
+    while (nr_active < WALK_GROUP_SIZE && start_walk(walks[nr_active])) {
+        nr_active++;
+    }
+
+    while (nr_active > 0) {
+        for (int w = 0; w < nr_active; ++w) {
+            Walk& walk = walks[w];
+            fp_array_entry_t fp_item = fp[walk.pos];
+            bool done = fp_item.item == 0;
+            if (!done) {
+                walk.ancestors.emplace_back(fp_item.item, walk.pos);
+
+                // Get the next parent
+                walk.pos = fp_item.parent_pos;
+                if (walk.pos >= fp_size) {
+                    done = true; // Bounds check
+                } else {
+                    __builtin_prefetch(&fp[walk.pos]);
+                }
+            }
+            // A finished walk is replaced by the next ElePos or by the last active walk
+            if (done) {
+                finish_walk(walk);
+                if (!start_walk(walk)) {
+                    std::swap(walk, walks[--nr_active]);
+                    w--;
+                }
+            }
+        }
+    }
+}
+
+// Same walks as walk_sequential(), read from the entries after the node's own slot in the
+// runs, jumping to the continuing run at every link
+template <typename Emit>
+static inline void walk_paths(size_t begin, size_t end,
+                              const std::vector<ElePosEntry>& ele_pos,
+                              const std::vector<FPArrayEntry>& fp_array,
+                              const PathRuns& paths,
+                              Emit&& emit) {
+    const uint32_t* items = paths.items.data();
+    const uint32_t* positions = paths.positions.data();
+    for (size_t i = begin; i < end; i++) {
+        elepos_entry_t entry = ele_pos[i];
+        if (entry.item == 0) {
+            continue; // Skip if item is 0 (root)
+        }
+        if (entry.pos >= fp_array.size()) continue; // Bounds check
+
+        uint32_t k = paths.offsets[entry.pos] + 1;
+        while (true) {
+            if (items[k] == 0) {
+                if (positions[k] == PATH_RUN_ROOT) break;
+                k = positions[k];
+                continue;
+            }
+            // Create candidate itemsets
+            emit(entry.item, items[k], positions[k], entry.support);
+            ++k;
+        }
+    }
+}
+
+// Walk the ancestors of every ElePos in [begin, end) and call
+// emit(prefix_item, suffix_item, suffix_item_pos, support) for each candidate.
+// How close a parent sits to its child depends on the layout and the tree, interleaving
+// pays off only when misses dominate, so it is opt-in and never used for arrays that fit
+// the last-level cache.
+template <typename Emit>
+static inline void walk_candidates(size_t begin, size_t end,
+                                   const std::vector<ElePosEntry>& ele_pos,
+                                   const std::vector<FPArrayEntry>& fp_array,
+                                   const PathRuns& paths,
+                                   bool interleave,
+                                   Emit&& emit) {
+    static const size_t llc_bytes = last_level_cache_bytes();
+    if (!paths.empty()) {
+        walk_paths(begin, end, ele_pos, fp_array, paths, emit);
+    } else if (interleave && fp_array.size() * sizeof(FPArrayEntry) > llc_bytes) {
+        walk_interleaved(begin, end, ele_pos, fp_array, emit);
+    } else {
+        walk_sequential(begin, end, ele_pos, fp_array, emit);
+    }
+}
+
+void count_candidates_worker(size_t begin, size_t end,
+                             const std::vector<ElePosEntry>& ele_pos,
+                             const std::vector<FPArrayEntry>& fp_array,
+                             const PathRuns& paths,
+                             bool interleave,
+                             CandidateTable& local_table) {
+    walk_candidates(begin, end, ele_pos, fp_array, paths, interleave, [&](uint32_t prefix_item, uint32_t suffix_item, uint32_t, uint32_t support) {
+        local_table.add_support(CandidateTable::make_key(prefix_item, suffix_item), support);
+    });
+}
+
+void collect_candidates_worker(size_t begin, size_t end,
+                               const std::vector<ElePosEntry>& ele_pos,
+                               const std::vector<FPArrayEntry>& fp_array,
+                               const PathRuns& paths,
+                               bool interleave,
+                               const std::vector<CandidateTable>& candidate_tables,
+                               uint32_t min_support,
+                               std::vector<std::vector<CandidateEntry>>& buckets) {
+    uint32_t nr_partitions = candidate_tables.size();
+    walk_candidates(begin, end, ele_pos, fp_array, paths, interleave, [&](uint32_t prefix_item, uint32_t suffix_item, uint32_t suffix_item_pos, uint32_t support) {
+        uint32_t partition = CandidateTable::partition_of(prefix_item, nr_partitions);
+        const CandidateTable::Slot* slot = candidate_tables[partition].find(CandidateTable::make_key(prefix_item, suffix_item));
+        if (slot != nullptr && slot->support >= min_support) {
+            buckets[partition].push_back(CandidateEntry {prefix_item, suffix_item, suffix_item_pos, support});
+        }
+    });
+}
+
+void count_pairs_worker(size_t begin, size_t end,
+                        const std::vector<ElePosEntry>& ele_pos,
+                        const std::vector<FPArrayEntry>& fp_array,
+                        const PathRuns& paths,
+                        bool interleave,
+                        const std::vector<int32_t>& item_rank, uint32_t nr_items,
+                        uint32_t* pair_supports, bool shared) {
+    if (shared) {
+        walk_candidates(begin, end, ele_pos, fp_array, paths, interleave, [&](uint32_t prefix_item, uint32_t suffix_item, uint32_t, uint32_t support) {
+            __atomic_fetch_add(&pair_supports[item_rank[prefix_item] * nr_items + item_rank[suffix_item]], support, __ATOMIC_RELAXED);
+        });
+        return;
+    }
+    walk_candidates(begin, end, ele_pos, fp_array, paths, interleave, [&](uint32_t prefix_item, uint32_t suffix_item, uint32_t, uint32_t support) {
+        pair_supports[item_rank[prefix_item] * nr_items + item_rank[suffix_item]] += support;
+    });
+}
+
+static void add_pair_supports_scalar(uint32_t* dst, const uint32_t* src, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        dst[i] += src[i];
+    }
+}
+
+__attribute__((target("avx2")))
+static void add_pair_supports_avx2(uint32_t* dst, const uint32_t* src, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i vd = _mm256_loadu_si256((const __m256i*)(dst + i));
+        __m256i vs = _mm256_loadu_si256((const __m256i*)(src + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_add_epi32(vd, vs));
+    }
+    add_pair_supports_scalar(dst + i, src + i, n - i);
+}
+
+void add_pair_supports(uint32_t* dst, const uint32_t* src, size_t n) {
+    static void (*const kernel)(uint32_t*, const uint32_t*, size_t) =
+        (__builtin_cpu_init(), __builtin_cpu_supports("avx2")) ? add_pair_supports_avx2 : add_pair_supports_scalar;
+    kernel(dst, src, n);
+}
@@ -0,0 +1,128 @@
+#include "include/thread_pool.h"
+
+#include <algorithm>
+#include <pthread.h>
+#include <sched.h>
+
+#include "include/param.h"
+
+static thread_local bool inside_pool = false;
+
+static void pin_to_core(int core) {
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(core % std::max(1u, std::thread::hardware_concurrency()), &cpuset);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+}
+
+ThreadPool::~ThreadPool() {
+    stop_workers();
+}
+
+void ThreadPool::configure(int nr_threads, bool pin) {
+    std::lock_guard<std::mutex> submit_lock(_submit_mutex);
+    stop_workers();
+    if (nr_threads <= 0) {
+        nr_threads = std::thread::hardware_concurrency();
+    }
+    if (nr_threads <= 0) {
+        nr_threads = DEFAULT_NR_THREADS;
+    }
+    _nr_threads = nr_threads;
+    _pin = pin;
+    if (_pin) {
+        pin_to_core(0);
+    }
+    start_workers();
+}
+
+int ThreadPool::size() {
+    if (_nr_threads == 0) {
+        configure(0, false);
+    }
+    return _nr_threads;
+}
+
+void ThreadPool::start_workers() {
+    // Workers of a reconfigured pool wait for the next generation, not one that already finished
+    uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = false;
+        generation = _generation;
+    }
+    for (int i = 1; i < _nr_threads; ++i) {
+        _workers.emplace_back(&ThreadPool::worker_loop, this, i, generation);
+    }
+}
+
+void ThreadPool::stop_workers() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _wake.notify_all();
+    for (auto& worker : _workers) {
+        worker.join();
+    }
+    _workers.clear();
+}
+
+void ThreadPool::parallel_for(int n, const std::function<void(int)>& fn) {
+    if (n <= 0) return;
+    size();
+    if (n == 1 || _workers.empty() || inside_pool) {
+        for (int i = 0; i < n; ++i) {
+            fn(i);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> submit_lock(_submit_mutex);
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _fn = &fn;
+        _nr_tasks = n;
+        _next_task.store(0);
+        _busy_workers = _workers.size();
+        _generation++;
+    }
+    _wake.notify_all();
+
+    inside_pool = true;
+    run_tasks();
+    inside_pool = false;
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _done.wait(lock, [this]() { return _busy_workers == 0; });
+    _fn = nullptr;
+}
+
+void ThreadPool::worker_loop(int worker_id, uint64_t seen) {
+    if (_pin) {
+        pin_to_core(worker_id);
+    }
+    inside_pool = true;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake.wait(lock, [this, seen]() { return _stop || _generation != seen; });
+            if (_stop) return;
+            seen = _generation;
+        }
+        run_tasks();
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (--_busy_workers == 0) {
+                _done.notify_one();
+            }
+        }
+    }
+}
+
+void ThreadPool::run_tasks() {
+    int task;
+    while ((task = _next_task.fetch_add(1)) < _nr_tasks) {
+        (*_fn)(task);
+    }
+}
@@ -0,0 +1,33 @@
+#include "itemset_trie.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// Expands a binary itemset trie back into the text format, one itemset per line
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        printf("Usage: %s <trie_file> <output_file> [--support]\n", argv[0]);
+        return 1;
+    }
+    bool with_support = argc > 3 && strcmp(argv[3], "--support") == 0;
+
+    try {
+        ItemsetTrie trie(argv[1]);
+        std::ofstream output(argv[2]);
+        trie.for_each_itemset([&output, with_support](const std::vector<uint32_t>& items, uint32_t support) {
+            for (size_t i = 0; i < items.size(); ++i) {
+                if (i > 0) output << ' ';
+                output << items[i];
+            }
+            if (with_support) output << " (" << support << ")";
+            output << '\n';
+        });
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -6,6 +6,7 @@ INPUT_DIR="input"
 OUTPUT_DIR="output"
 ORIGINAL_EXE="original/fpgrowth"
 PFP_EXE="pfp_growth/fpgrowth_cpu"
+PFP_ARGS=(--engine fptree) # Compare the FP-tree miner, not whatever --engine auto picks
 UPMEM_EXE="upmem_hist/build/main"
 PY_SCRIPT="python/fp_growth.py"
 VENV_DIR="python/venv"
@@ -90,7 +91,7 @@ echo "----------------------------------------"
 # Test pfp_growth C++ executable
 echo "Warming up pfp_growth C++ executable..."
 if [ -f "$PFP_EXE" ]; then
-    sudo LD_LIBRARY_PATH=$LD_LIBRARY_PATH "$PFP_EXE" "$INPUT_DIR/test.txt" "2" "$OUTPUT_DIR/test.txt"
+    sudo LD_LIBRARY_PATH=$LD_LIBRARY_PATH "$PFP_EXE" "$INPUT_DIR/test.txt" "2" "$OUTPUT_DIR/test.txt" "${PFP_ARGS[@]}"
 else
     echo "✗ PFP Growth C++ executable not found"
 fi
@@ -150,7 +151,7 @@ for input_file in "$INPUT_DIR"/*; do
         
         echo "Running pfp_growth C++ on $input_file with min_support=$min_support..."
         start_time=$(date +%s.%N)
-        sudo LD_LIBRARY_PATH=$LD_LIBRARY_PATH "$PFP_EXE" "$input_file" "$min_support" "$OUTPUT_DIR/${base_name}_ms${min_support}_pfp.$ext"
+        sudo LD_LIBRARY_PATH=$LD_LIBRARY_PATH "$PFP_EXE" "$input_file" "$min_support" "$OUTPUT_DIR/${base_name}_ms${min_support}_pfp.$ext" "${PFP_ARGS[@]}"
         end_time=$(date +%s.%N)
         pfp_time=$(echo "$end_time - $start_time" | bc)
         
@@ -0,0 +1,121 @@
+#include <mram.h>
+#include <stdint.h>
+#include <defs.h>
+#include <barrier.h>
+#include <alloc.h>
+
+#include "param.h"
+#include "common.h"
+
+// Rewrite the transactions left in MRAM by db_count_item: infrequent items are dropped, items
+// become their frequency rank and are sorted by it. An item repeated in a transaction is kept
+// once, like the host filter does. Every transaction keeps its slot, the freed tail is filled
+// with TRX_END.
+
+__host uint32_t count;                      // Elements in the transaction buffer, including markers
+__host int32_t item_rank[NR_DB_ITEMS];      // Rank of every item, -1 when infrequent
+
+#define CACHE_ELEM (BLOCK_SIZE >> 2)        // BLOCK_SIZE / sizeof(int32_t)
+#define RANK_WORDS (NR_DB_ITEMS / 32)
+
+// item_rank plus a transaction cache, an output block and a rank bitmap of NR_DB_ITEMS / 8 bytes
+// per tasklet, the rest of the 64 KB WRAM is left to the stacks and the runtime
+#define FILTER_WRAM_BYTES (NR_DB_ITEMS * 4 + NR_TASKLETS * (2 * BLOCK_SIZE + NR_DB_ITEMS / 8))
+#if FILTER_WRAM_BYTES > (48 << 10)
+#error "item_rank and the per-tasklet rank bitmaps do not fit in WRAM, lower NR_DB_ITEMS or NR_TASKLETS"
+#endif
+
+BARRIER_INIT(barrier, NR_TASKLETS);
+uint32_t tasklet_start[NR_TASKLETS + 1];
+
+typedef struct {
+    int32_t* data;
+    uint32_t base;                          // First element held, UINT32_MAX when empty
+} trx_cache_t;
+
+// Assumes the heap still holds the transaction buffer db_count_item was given: loading this
+// program leaves the MRAM heap alone, and the host only loads it when the whole database was
+// counted in a single round with nothing copied to the DPUs since, see Database::filtered_items().
+static inline int32_t read_item(trx_cache_t* cache, uint32_t pos) {
+    if (pos < cache->base || pos >= cache->base + CACHE_ELEM) {
+        cache->base = pos - (pos % CACHE_ELEM);
+        mram_read((__mram_ptr void const*) (DPU_MRAM_HEAP_POINTER + cache->base * sizeof(int32_t)), cache->data, BLOCK_SIZE);
+    }
+    return cache->data[pos - cache->base];
+}
+
+// Write the set ranks in ascending order to slot [begin, end), both even
+static void write_slot(uint32_t* ranks, int32_t* out, uint32_t begin, uint32_t end) {
+    uint32_t filled = 0;
+    uint32_t pos = begin;
+    for (uint32_t w = 0; w < RANK_WORDS; w++) {
+        uint32_t bits = ranks[w];
+        while (bits != 0) {
+            uint32_t bit = __builtin_ctz(bits);
+            bits &= bits - 1;
+            out[filled++] = w * 32 + bit;
+            if (filled == CACHE_ELEM) {
+                mram_write(out, (__mram_ptr void*) (DPU_MRAM_HEAP_POINTER + pos * sizeof(int32_t)), BLOCK_SIZE);
+                pos += filled;
+                filled = 0;
+            }
+        }
+        ranks[w] = 0;
+    }
+    while (pos + filled < end) {
+        out[filled++] = TRX_END;
+        if (filled == CACHE_ELEM || pos + filled == end) {
+            mram_write(out, (__mram_ptr void*) (DPU_MRAM_HEAP_POINTER + pos * sizeof(int32_t)), filled * sizeof(int32_t));
+            pos += filled;
+            filled = 0;
+        }
+    }
+}
+
+int main() {
+    const sysname_t id = me();
+
+    if (id == 0) {
+        mem_reset();
+    }
+    barrier_wait(&barrier);
+
+    trx_cache_t cache = {(int32_t*) mem_alloc(BLOCK_SIZE), UINT32_MAX};
+    int32_t* out = (int32_t*) mem_alloc(BLOCK_SIZE);
+    uint32_t* ranks = (uint32_t*) mem_alloc(RANK_WORDS * sizeof(uint32_t));
+    for (uint32_t w = 0; w < RANK_WORDS; w++) {
+        ranks[w] = 0;
+    }
+
+    // A tasklet rewrites the transactions starting in its range. Every transaction ends with an
+    // odd-positioned TRX_END, so a start is found without reading any transaction twice.
+    uint32_t per_tasklet = (count / NR_TASKLETS + 1) & ~1u;
+    uint32_t pos = id * per_tasklet < count ? id * per_tasklet : count;
+    if (pos > 0 && pos < count && read_item(&cache, pos - 1) != TRX_END) {
+        while (read_item(&cache, pos) != TRX_END) pos++; // Owned by the previous tasklet
+        pos = (pos + 2) & ~1u;
+    }
+    tasklet_start[id] = pos;
+    if (id == 0) {
+        tasklet_start[NR_TASKLETS] = count;
+    }
+    // Nothing is written before every start is known
+    barrier_wait(&barrier);
+
+    uint32_t end = tasklet_start[id + 1];
+    while (pos < end) {
+        uint32_t start = pos;
+        int32_t item;
+        while ((item = read_item(&cache, pos)) != TRX_END) {
+            int32_t rank = item_rank[item];
+            if (rank >= 0) {
+                ranks[rank >> 5] |= 1u << (rank & 31); // Sets a repeated item again, it is written once
+            }
+            pos++;
+        }
+        pos = (pos + 2) & ~1u; // Past the end marker and its padding
+        write_slot(ranks, out, start, pos);
+    }
+
+    return 0;
+}
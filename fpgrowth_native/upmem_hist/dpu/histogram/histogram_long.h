@@ -63,6 +63,7 @@ static void histogram_long(uint32_t count) {
 
         mram_read((__mram_ptr void const*) (BUFFER_ADDR + (i * sizeof(int32_t))), cache, bytes);
         for (uint32_t k = 0; k < take_elems; k++) {
+            if (cache[k] < 0) continue; // Transaction end marker
             mutex_pool_lock(&local_mutexes, histo_id);
             local_hist[cache[k]] += 1u;
             mutex_pool_unlock(&local_mutexes, histo_id);
@@ -40,6 +40,7 @@ static void histogram_short(uint32_t count) {
 
         mram_read((__mram_ptr void const*) (BUFFER_ADDR + (i * sizeof(int32_t))), cache, bytes);
         for (uint32_t k = 0; k < take_elems; k++) {
+            if (cache[k] < 0) continue; // Transaction end marker
             local_hist[cache[k]] += 1u;
         }
     }
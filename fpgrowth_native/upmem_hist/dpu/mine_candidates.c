@@ -12,17 +12,28 @@
 #include "common.h"
 
 __host uint32_t k_elepos_size;
+__host uint32_t mine_phase;
+__host uint32_t table_bits;     // Phase 1 table or phase 2 key set has 1 << table_bits slots
+__host uint32_t nr_out;         // Phase 1: distinct keys, phase 2: emitted candidates or next-level ElePos
+__host uint32_t elepos_slot;    // Resident mining reads ElePos from this slot and writes the other one
+__host uint64_t next_weight;    // Resident mining: candidates the next-level ElePos will walk
+// MRAM layout planned by the host, the FP-array starts at 0
+__host uint32_t elepos_offset;
+__host uint32_t elepos_slot_size;
+__host uint32_t candidate_offset;
 
 //---------------------------------------
 // FP Growth structures
 typedef struct ElePosEntry elepos_entry_t;
-typedef struct FPArrayEntry fp_array_entry_t;
+typedef struct PackedFPArrayEntry fp_array_entry_t;
 typedef struct CandidateEntry candidate_entry_t;
+typedef struct KeySupportEntry key_support_entry_t;
 //---------------------------------------
 
 //---------------------------------------
 // Cache Implementation
-#define WAYS (2)
+// A block takes 16 bytes with packed entries, 3 ways fill the WRAM 2 ways of 24 bytes did
+#define WAYS (3)
 #define SET_BITS (10) // TODO: Test with different set sizes and associativity
 #define SETS (1 << SET_BITS)
 
@@ -137,22 +148,237 @@ static inline void get_fp_array_item(uint32_t idx, fp_array_entry_t* item) {
     *item = cache_fp_array_entry_read(idx);
 }
 
+static inline __mram_ptr elepos_entry_t* elepos_slot_entry(uint32_t slot, uint32_t idx) {
+    return (__mram_ptr elepos_entry_t*) (DPU_MRAM_HEAP_POINTER + elepos_offset + slot * elepos_slot_size + idx * sizeof(elepos_entry_t));
+}
+
 static inline void get_k_elepos_item(uint32_t idx, elepos_entry_t* item) {
-    mram_read((__mram_ptr void const*) (DPU_MRAM_HEAP_POINTER + MRAM_FP_ARRAY_SZ + idx * sizeof(elepos_entry_t)), item, sizeof(elepos_entry_t));
+    mram_read(elepos_slot_entry(elepos_slot, idx), item, sizeof(elepos_entry_t));
+}
+
+//---------------------------------------
+// Candidate region, reused by both phases
+//   Phase 1: key_support_entry_t table[1 << table_bits], then the compacted keys
+//   Phase 2: uint64_t key_set[1 << table_bits] from the host, then the emitted candidates
+//   Resident: key_support_entry_t key_set[1 << table_bits] from the host, support holds the itemset id
+#define CANDIDATE_REGION (DPU_MRAM_HEAP_POINTER + candidate_offset)
+#define TABLE_LOCKS (1024)
+
+// Every tasklet owns a WRAM buffer of 16-byte entries, zeroed at start. It is the zero block of
+// clear_table(), then the pre-aggregation table of the walk, then the scan buffer of compact_table().
+// key_support_entry_t and candidate_entry_t are both 16 bytes.
+#define TASKLET_BUFFER_BITS (5)
+#define TASKLET_BUFFER_ENTRIES (1 << TASKLET_BUFFER_BITS)
+#define TASKLET_BUFFER_BYTES (TASKLET_BUFFER_ENTRIES * sizeof(key_support_entry_t))
+
+VMUTEX_INIT(table_vmutex, TABLE_LOCKS, 16);
+uint8_t* tasklet_buffers;
+uint32_t tasklet_keys[NR_TASKLETS];
+
+// The cache, the tasklet buffers, the stacks and the lock bits of both vmutexes, with 1 KB left
+// to the runtime and the remaining globals. mem_alloc() would only fail on the DPU otherwise.
+#ifndef STACK_SIZE_DEFAULT
+#define STACK_SIZE_DEFAULT (256)
+#endif
+#define CACHE_BLOCK_BYTES (16)
+#define MINE_WRAM_BYTES (SETS * WAYS * CACHE_BLOCK_BYTES + NR_TASKLETS * (TASKLET_BUFFER_ENTRIES * 16 + STACK_SIZE_DEFAULT) \
+                         + (SETS + TABLE_LOCKS) / 8)
+#if MINE_WRAM_BYTES > (63 << 10)
+#error "The FP-array cache, tasklet buffers and stacks do not fit in WRAM, lower SET_BITS, WAYS or TASKLET_BUFFER_BITS"
+#endif
+_Static_assert(sizeof(cache_block_t) == CACHE_BLOCK_BYTES, "MINE_WRAM_BYTES assumes 16-byte cache blocks");
+_Static_assert(sizeof(key_support_entry_t) == 16, "MINE_WRAM_BYTES assumes 16-byte buffer entries");
+
+static inline uint8_t* tasklet_buffer(uint32_t id) {
+    return tasklet_buffers + id * TASKLET_BUFFER_BYTES;
+}
+
+static inline __mram_ptr key_support_entry_t* table_slot(uint32_t idx) {
+    return (__mram_ptr key_support_entry_t*) (CANDIDATE_REGION + idx * sizeof(key_support_entry_t));
+}
+
+static void table_add_support(uint64_t key, uint32_t support) {
+    uint32_t mask = (1u << table_bits) - 1;
+    uint32_t idx = dpu_key_hash(key) & mask;
+    key_support_entry_t entry;
+    while (1) {
+        vmutex_lock(&table_vmutex, idx & (TABLE_LOCKS - 1));
+        mram_read(table_slot(idx), &entry, sizeof(entry));
+        if (entry.key == key || entry.key == DPU_EMPTY_KEY) {
+            entry.key = key;
+            entry.support += support;
+            mram_write(&entry, table_slot(idx), sizeof(entry));
+            vmutex_unlock(&table_vmutex, idx & (TABLE_LOCKS - 1));
+            return;
+        }
+        vmutex_unlock(&table_vmutex, idx & (TABLE_LOCKS - 1));
+        idx = (idx + 1) & mask;
+    }
+}
+
+static int key_set_contains(uint64_t key) {
+    uint32_t mask = (1u << table_bits) - 1;
+    uint32_t idx = dpu_key_hash(key) & mask;
+    uint64_t slot_key;
+    while (1) {
+        mram_read((__mram_ptr void const*) (CANDIDATE_REGION + idx * sizeof(uint64_t)), &slot_key, sizeof(slot_key));
+        if (slot_key == key) return 1;
+        if (slot_key == DPU_EMPTY_KEY) return 0;
+        idx = (idx + 1) & mask;
+    }
+}
+
+// Itemset id of a frequent key, 0 when the key is not frequent
+static uint32_t key_set_itemset_id(uint64_t key) {
+    uint32_t mask = (1u << table_bits) - 1;
+    uint32_t idx = dpu_key_hash(key) & mask;
+    key_support_entry_t slot;
+    while (1) {
+        mram_read(table_slot(idx), &slot, sizeof(slot));
+        if (slot.key == key) return slot.support;
+        if (slot.key == DPU_EMPTY_KEY) return 0;
+        idx = (idx + 1) & mask;
+    }
+}
+
+// Each tasklet owns a contiguous slice of the table, table_bits >= MIN_TABLE_BITS keeps slices block aligned
+static inline void table_slice(uint32_t id, uint32_t* begin, uint32_t* end) {
+    uint32_t per_tasklet = (1u << table_bits) / NR_TASKLETS;
+    *begin = id * per_tasklet;
+    *end = *begin + per_tasklet;
 }
 
-static inline void set_candidate_item(uint32_t idx, const candidate_entry_t* item) {
-    mram_write(item, (__mram_ptr void*) (DPU_MRAM_HEAP_POINTER + MRAM_FP_ARRAY_SZ + MRAM_FP_ELEPOS_SZ + idx * sizeof(candidate_entry_t)), sizeof(candidate_entry_t));
+static void clear_table(uint32_t id) {
+    uint32_t begin, end;
+    table_slice(id, &begin, &end);
+    uint32_t bytes = (end - begin) * sizeof(key_support_entry_t);
+    for (uint32_t done = 0; done < bytes; done += TASKLET_BUFFER_BYTES) {
+        uint32_t size = bytes - done < TASKLET_BUFFER_BYTES ? bytes - done : TASKLET_BUFFER_BYTES;
+        mram_write(tasklet_buffer(id), (__mram_ptr void*) ((__mram_ptr uint8_t*) table_slot(begin) + done), size);
+    }
 }
 
+// Move the used slots behind the table so the host reads back only nr_out entries
+static void compact_table(uint32_t id) {
+    uint32_t begin, end;
+    table_slice(id, &begin, &end);
+    key_support_entry_t* buffer = (key_support_entry_t*) tasklet_buffer(id);
+
+    uint32_t count = 0;
+    for (uint32_t idx = begin; idx < end; idx += TASKLET_BUFFER_ENTRIES) {
+        mram_read(table_slot(idx), buffer, TASKLET_BUFFER_ENTRIES * sizeof(key_support_entry_t));
+        for (uint32_t j = 0; j < TASKLET_BUFFER_ENTRIES; j++) {
+            if (buffer[j].key != DPU_EMPTY_KEY) count++;
+        }
+    }
+    tasklet_keys[id] = count;
+    barrier_wait(&barrier);
+
+    uint32_t out = 1u << table_bits;
+    for (uint32_t t = 0; t < id; t++) {
+        out += tasklet_keys[t];
+    }
+    if (id == NR_TASKLETS - 1) {
+        nr_out = out + count - (1u << table_bits);
+    }
+    for (uint32_t idx = begin; idx < end; idx += TASKLET_BUFFER_ENTRIES) {
+        mram_read(table_slot(idx), buffer, TASKLET_BUFFER_ENTRIES * sizeof(key_support_entry_t));
+        for (uint32_t j = 0; j < TASKLET_BUFFER_ENTRIES; j++) {
+            if (buffer[j].key != DPU_EMPTY_KEY) {
+                mram_write(&buffer[j], table_slot(out++), sizeof(key_support_entry_t));
+            }
+        }
+    }
+}
+
+// A resident candidate carries the itemset id as prefix_item and the depth of its position as suffix_item
+static inline void emit_candidate(const candidate_entry_t* item) {
+    mutex_lock(mutex);
+    uint32_t idx = nr_out++;
+    if (mine_phase == MINE_PHASE_RESIDENT) {
+        next_weight += item->suffix_item - 1;
+    }
+    mutex_unlock(mutex);
+
+    if (mine_phase == MINE_PHASE_RESIDENT) {
+        // The host only enters this phase when the slot holds every candidate walked from the current one
+        elepos_entry_t next = {item->prefix_item, item->suffix_item_pos, item->support, 0};
+        mram_write(&next, elepos_slot_entry(elepos_slot ^ 1, idx), sizeof(elepos_entry_t));
+    } else {
+        uint32_t base = (1u << table_bits) * sizeof(uint64_t);
+        mram_write(item, (__mram_ptr void*) (CANDIDATE_REGION + base + idx * sizeof(candidate_entry_t)), sizeof(candidate_entry_t));
+    }
+}
+
+// WRAM pre-aggregation, direct-mapped. Consecutive ElePos of a tasklet share their prefix item and
+// the upper part of their paths, so most keys hit and never lock or touch the MRAM table.
+// An evicted or flushed slot goes to the MRAM table (phase 1) or is emitted (phase 2).
+static inline void preagg_add_support(key_support_entry_t* slots, uint64_t key, uint32_t support) {
+    key_support_entry_t* slot = &slots[dpu_key_hash(key) & (TASKLET_BUFFER_ENTRIES - 1)];
+    if (slot->key != key) {
+        if (slot->key != DPU_EMPTY_KEY) {
+            table_add_support(slot->key, slot->support);
+        }
+        slot->key = key;
+        slot->support = 0;
+    }
+    slot->support += support;
+}
+
+// Phase 2 merges candidates of the same prefix and position, an empty slot has support 0.
+// Resident candidates are keyed by itemset id, so this merges the next-level ElePos.
+static inline void preagg_emit(candidate_entry_t* slots, const candidate_entry_t* candidate) {
+    uint32_t hash = candidate->prefix_item * 0x9E3779B1u + candidate->suffix_item_pos;
+    candidate_entry_t* slot = &slots[hash & (TASKLET_BUFFER_ENTRIES - 1)];
+    if (slot->support != 0 && (slot->prefix_item != candidate->prefix_item || slot->suffix_item_pos != candidate->suffix_item_pos)) {
+        emit_candidate(slot);
+        slot->support = 0;
+    }
+    if (slot->support == 0) {
+        *slot = *candidate;
+    } else {
+        slot->support += candidate->support;
+    }
+}
+
+static void preagg_flush(uint32_t id) {
+    for (uint32_t i = 0; i < TASKLET_BUFFER_ENTRIES; i++) {
+        if (mine_phase == MINE_PHASE_COUNT) {
+            key_support_entry_t* slot = (key_support_entry_t*) tasklet_buffer(id) + i;
+            if (slot->key != DPU_EMPTY_KEY) {
+                table_add_support(slot->key, slot->support);
+            }
+        } else {
+            candidate_entry_t* slot = (candidate_entry_t*) tasklet_buffer(id) + i;
+            if (slot->support != 0) {
+                emit_candidate(slot);
+            }
+        }
+    }
+}
+//---------------------------------------
+
 int main() {
     const sysname_t id = me();
 
     if (id == 0) {
         mem_reset();
         cache_sets = init_cache();
+        tasklet_buffers = (uint8_t*) mem_alloc(NR_TASKLETS * TASKLET_BUFFER_BYTES);
+        nr_out = 0;
+        next_weight = 0;
     }
     barrier_wait(&barrier);
+
+    uint8_t* buffer = tasklet_buffer(id);
+    for (uint32_t i = 0; i < TASKLET_BUFFER_BYTES; i++) {
+        buffer[i] = 0;
+    }
+
+    if (mine_phase == MINE_PHASE_COUNT) {
+        clear_table(id);
+        barrier_wait(&barrier);
+    }
     
     for (int i = id; i < k_elepos_size; i += NR_TASKLETS) {
         candidate_entry_t candidate;
@@ -167,17 +393,35 @@ int main() {
         uint32_t suffix_idx = fp_item.parent_pos;
         get_fp_array_item(fp_item.parent_pos, &fp_item); // Get the parent FPArrayEntry
         
-        int candidate_idx = 0;
         while (fp_item.item != 0) {
-            candidate.prefix_item = entry.item;
-            candidate.suffix_item = fp_item.item;
-            candidate.suffix_item_pos = suffix_idx;
-            candidate.support = entry.support;
-
-            set_candidate_item(entry.candidate_start_idx + candidate_idx++, &candidate);
+            uint64_t key = dpu_make_key(entry.item, fp_item.item);
+            if (mine_phase == MINE_PHASE_COUNT) {
+                preagg_add_support((key_support_entry_t*) buffer, key, entry.support);
+            } else if (mine_phase == MINE_PHASE_COLLECT && key_set_contains(key)) {
+                candidate.prefix_item = entry.item;
+                candidate.suffix_item = fp_item.item;
+                candidate.suffix_item_pos = suffix_idx;
+                candidate.support = entry.support;
+                preagg_emit((candidate_entry_t*) buffer, &candidate);
+            } else if (mine_phase == MINE_PHASE_RESIDENT) {
+                uint32_t itemset_id = key_set_itemset_id(key);
+                if (itemset_id != 0) {
+                    candidate.prefix_item = itemset_id;
+                    candidate.suffix_item = fp_item.depth;
+                    candidate.suffix_item_pos = suffix_idx;
+                    candidate.support = entry.support;
+                    preagg_emit((candidate_entry_t*) buffer, &candidate);
+                }
+            }
 
             suffix_idx = fp_item.parent_pos;
             get_fp_array_item(fp_item.parent_pos, &fp_item); // Get the next parent
         }
     }
-}
\ No newline at end of file
+
+    preagg_flush(id);
+    if (mine_phase == MINE_PHASE_COUNT) {
+        barrier_wait(&barrier);
+        compact_table(id);
+    }
+}
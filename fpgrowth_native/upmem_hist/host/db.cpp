@@ -5,6 +5,9 @@
 #include <cstdint>
 #include <thread>
 
+#include "common.h"
+#include "dpu_resources.h"
+#include "dpu_transfer.h"
 #include "param.h"
 #include "timer.h"
 
@@ -77,22 +80,18 @@ void Database::dpu_count_items(dpu::DpuSet& system, std::vector<std::vector<int3
     std::vector<std::vector<uint32_t>> counts(nr_of_dpus, std::vector<uint32_t>(1, 0));
     std::vector<std::vector<uint32_t>> results(nr_of_dpus, std::vector<uint32_t>(NR_DB_ITEMS, 0));
     
+    _trx_sizes.assign(nr_of_dpus, 0);
     for (uint32_t i = 0; i < nr_of_dpus; i++) {
         counts[i][0] = buffers[i].size();
-        if (i == 0) {
-            if (counts[0][0] % 2 == 1) {
-                buffers[0].push_back(0); // Ensure even number of elements for DPU processing
-            }
-        } else {
-            int padding = buffers[0].size() - buffers[i].size();
-            if (padding > 0) {
-                buffers[i].resize(buffers[i].size() + padding, 0); // Pad with zeros
-            } 
-        }
+        _trx_sizes[i] = buffers[i].size();
     }
+    _nr_count_rounds++;
+    // Padded to the longest buffer of each rank only, transfers are rounded up to 8 bytes
+    std::vector<std::vector<std::vector<int32_t>>> by_rank = group_by_rank(dpus_per_rank(system), std::move(buffers), 0);
 
     Timer::instance().start("Count Items - Transfer(To DPU)");
-    system.copy(DPU_MRAM_HEAP_POINTER_NAME, buffers);
+    push_ragged(system, DPU_MRAM_HEAP_POINTER_NAME, 0, by_rank);
+    system.async().sync();
     system.copy("count", counts);
     Timer::instance().stop();
 
@@ -121,33 +120,40 @@ std::vector<std::pair<int, int>> Database::scan_for_frequent_items(int min_suppo
     seek_to_start();
     
     try {
-        Timer::instance().start("Count Items - DPU Init");
-        auto system = dpu::DpuSet::allocate(NR_DPUS, DPU_CONFIG);
-        system.load(DPU_DB_COUNT_ITEM);
-        Timer::instance().stop();
+        dpu::DpuSet& system = DpuResources::instance().acquire(DPU_DB_COUNT_ITEM);
         
         uint32_t nr_of_dpus = system.dpus().size();
         std::vector<std::vector<int32_t>> buffers(nr_of_dpus, std::vector<int32_t>());
 
+        // Whole transactions go round-robin to the DPUs, each one ended by TRX_END and padded to
+        // 8 bytes, so db_filter_item can rewrite them in place once the supports are known
         int buffer_idx = 0;
         std::string line;
+        std::vector<int32_t> transaction;
+        _nr_count_rounds = 0;
         Timer::instance().start("Count Items - Prepare");
         while (std::getline(_file, line)) {
             std::istringstream iss(line);
             int item;
+            transaction.clear();
             while (iss >> item) {
-                if (buffers[buffer_idx].size() >= MAX_ELEMS) {
-                    Timer::instance().stop();
-                    dpu_count_items(system, buffers);
-                    Timer::instance().start("Count Items - Prepare");
-                    buffer_idx = 0;
-                    for (uint32_t i = 0; i < nr_of_dpus; i++) {
-                        buffers[i].clear();
-                    }
+                transaction.push_back(item);
+            }
+            if (transaction.empty()) continue;
+
+            size_t slot = (transaction.size() + 2) & ~size_t(1);
+            if (buffers[buffer_idx].size() + slot > MAX_ELEMS) {
+                Timer::instance().stop();
+                dpu_count_items(system, buffers);
+                Timer::instance().start("Count Items - Prepare");
+                buffer_idx = 0;
+                for (uint32_t i = 0; i < nr_of_dpus; i++) {
+                    buffers[i].clear();
                 }
-                buffers[buffer_idx].push_back(item);
-                buffer_idx = (buffer_idx + 1) % nr_of_dpus;
             }
+            buffers[buffer_idx].insert(buffers[buffer_idx].end(), transaction.begin(), transaction.end());
+            buffers[buffer_idx].resize(buffers[buffer_idx].size() + slot - transaction.size(), TRX_END);
+            buffer_idx = (buffer_idx + 1) % nr_of_dpus;
         }
         Timer::instance().stop();
         if (buffers[0].size() > 0) {
@@ -167,14 +173,70 @@ std::vector<std::pair<int, int>> Database::scan_for_frequent_items(int min_suppo
         return a.second > b.second;
     });
 
+    _rank_item.clear();
     for (int i = 0; i < (int)frequent_items.size(); i++) {
         _item_priority[frequent_items[i].first] = frequent_items.size() - i;
+        _rank_item.push_back(frequent_items[i].first);
     }
     
     return frequent_items;
 }
 
+// Rewrite the transactions still in MRAM from the count phase to sorted frequency ranks
+std::vector<std::vector<int>> Database::dpu_filter_items(dpu::DpuSet& system) {
+    uint32_t nr_of_dpus = system.dpus().size();
+    std::vector<std::vector<uint32_t>> counts(nr_of_dpus, std::vector<uint32_t>(1, 0));
+    for (uint32_t i = 0; i < nr_of_dpus; i++) {
+        counts[i][0] = _trx_sizes[i];
+    }
+    std::vector<int32_t> item_rank(NR_DB_ITEMS, -1);
+    for (size_t rank = 0; rank < _rank_item.size(); rank++) {
+        item_rank[_rank_item[rank]] = rank;
+    }
+
+    Timer::instance().start("Filter Items - Transfer(To DPU)");
+    system.copy("count", counts);
+    system.copy("item_rank", item_rank);
+    Timer::instance().stop();
+
+    Timer::instance().start("Filter Items - Exec");
+    system.exec();
+    Timer::instance().stop();
+
+    Timer::instance().start("Filter Items - Transfer(To CPU)");
+    std::vector<std::vector<int32_t>> buffers = gather_ragged<int32_t>(system, DPU_MRAM_HEAP_POINTER_NAME, 0, _trx_sizes);
+    Timer::instance().stop();
+
+    Timer::instance().start("Filter Items - Postprocess");
+    std::vector<std::vector<int>> results;
+    std::vector<int> items;
+    for (uint32_t i = 0; i < nr_of_dpus; i++) {
+        for (uint32_t pos = 0; pos < _trx_sizes[i]; pos++) {
+            int32_t rank = buffers[i][pos];
+            if (rank != TRX_END) {
+                items.push_back(_rank_item[rank]);
+            } else if (!items.empty()) {
+                results.push_back(std::move(items));
+                items.clear();
+            }
+        }
+    }
+    Timer::instance().stop();
+    return results;
+}
+
 std::vector<std::vector<int>> Database::filtered_items() {
+    // Without a second count round the transactions of the count phase are all still in MRAM
+    if (_nr_count_rounds == 1) {
+        try {
+            dpu::DpuSet& system = DpuResources::instance().acquire(DPU_DB_FILTER_ITEM);
+            return dpu_filter_items(system);
+        } catch (const dpu::DpuError& e) {
+            std::cerr << e.what() << std::endl;
+        }
+    }
+
+    Timer::instance().start("Build FP-Tree - Filter & Sort");
 /** Multithreaded version of filtered_items
     std::vector<std::deque<std::vector<int>>> all_results(NR_THREADS);
     std::vector<std::pair<std::streampos, std::streampos>> parts = divide_file(_file, NR_THREADS);
@@ -224,9 +286,11 @@ std::vector<std::vector<int>> Database::filtered_items() {
             }
         }
         if (!items.empty()) {
+            // Rank order with repeated items dropped, the same transactions db_filter_item writes
             std::sort(items.begin(), items.end(), [this](int a, int b) {
-                return _item_count[a] > _item_count[b];
+                return _item_priority[a] > _item_priority[b];
             });
+            items.erase(std::unique(items.begin(), items.end()), items.end());
             results.push_back(items);
         }
     }
@@ -240,5 +304,6 @@ std::vector<std::vector<int>> Database::filtered_items() {
         printf("\n");
     }
     #endif
+    Timer::instance().stop();
     return results;
 }
\ No newline at end of file
@@ -0,0 +1,30 @@
+#include "dpu_resources.h"
+
+#include <iostream>
+
+#include "param.h"
+#include "timer.h"
+
+dpu::DpuSet& DpuResources::acquire(const std::string& program) {
+    if (!_system) {
+        Timer::instance().start("DPU Init - Allocate");
+        _system.reset(new dpu::DpuSet(dpu::DpuSet::allocate(NR_DPUS, DPU_CONFIG)));
+        Timer::instance().stop();
+        std::cout << "Allocated " << _system->dpus().size() << " DPUs in " << _system->ranks().size()
+                  << " ranks (" << DPU_CONFIG << ")" << std::endl;
+        _program.clear();
+    }
+
+    if (program != _program) {
+        Timer::instance().start("DPU Init - Load");
+        _system->load(program);
+        Timer::instance().stop();
+        _program = program;
+    }
+    return *_system;
+}
+
+void DpuResources::release() {
+    _system.reset();
+    _program.clear();
+}
@@ -3,9 +3,12 @@
 #include <vector>
 #include <map>
 #include <functional>
-#include <unordered_map>
 #include <utility>
+#include <stdexcept>
+#include <chrono>
+#include <thread>
 
+#include "dpu_resources.h"
 #include "param.h"
 #include "timer.h"
 
@@ -32,17 +35,17 @@ void FPTree::build_tree() {
     });
 
     _frequent_itemsets_1.clear();
+    _frequent_supports_1.clear();
     for (const auto& item : frequent_items) {
         _frequent_itemsets_1.push_back({static_cast<uint32_t>(item.first), -1});
+        _frequent_supports_1.push_back(item.second);
     }
 
     _db->seek_to_start();
     _leaf_head = nullptr;
     Timer::instance().stop();
 
-    Timer::instance().start("Build FP-Tree - Filter & Sort");
     std::vector<std::vector<int>> items_list = _db->filtered_items();
-    Timer::instance().stop();
 
     Timer::instance().start("Build FP-Tree");
     for (const auto& items : items_list) {
@@ -103,6 +106,11 @@ void FPTree::build_tree() {
 }
 
 void FPTree::build_fp_array() {
+    if (_layout == FPArrayLayout::Dfs) {
+        build_fp_array_dfs();
+        return;
+    }
+
     std::vector<int> item_idx_table(_node_cnt, -1);
     _fp_array.clear();
 
@@ -133,6 +141,25 @@ void FPTree::build_fp_array() {
     //std::cout << "FP-Array size: " << _fp_array.size() * sizeof(FPArrayEntry) / 1024.0 << " KB" << std::endl;
 }
 
+// DFS preorder: a node follows its parent directly or after its earlier siblings'
+// subtrees, so an ancestor walk mostly hits FP-array entries the DPU cache already holds
+void FPTree::build_fp_array_dfs() {
+    _fp_array.clear();
+
+    std::vector<std::pair<Node*, int32_t>> stack;
+    stack.push_back({_root, -1});
+    while (!stack.empty()) {
+        auto [node, parent_pos] = stack.back();
+        stack.pop_back();
+
+        int32_t pos = _fp_array.size();
+        _fp_array.push_back(FPArrayEntry {node->item, parent_pos, node->count, node->depth});
+        for (auto it = node->child.rbegin(); it != node->child.rend(); ++it) {
+            stack.push_back({*it, pos});
+        }
+    }
+}
+
 void FPTree::build_k1_ele_pos() {
     _k1_ele_pos.clear();
 
@@ -142,135 +169,841 @@ void FPTree::build_k1_ele_pos() {
     }
 }
 
-void FPTree::dpu_mine_candidates(dpu::DpuSet& system, const std::vector<ElePosEntry>& ele_pos, 
-                                 std::unordered_map<uint64_t, TempCandidates>& candidate_map) {
+static PackedFPArrayEntry pack_fp_array_entry(const FPArrayEntry& entry, int32_t parent_pos) {
+    return {parent_pos, static_cast<uint16_t>(entry.item), static_cast<uint16_t>(entry.depth)};
+}
+
+// Spread the root subtrees of an FP-array too large for one DPU over shards of whole ranks.
+// Subtrees go, heaviest walk first, to the least loaded shard with room for them, using as few
+// shards as fit. Every shard starts with a copy of the root, so a walk never leaves its shard,
+// and its entries keep their FP-array order. Returns the packed array of every shard.
+std::vector<std::vector<PackedFPArrayEntry>> FPTree::shard_fp_array(const std::vector<uint32_t>& rank_sizes) {
+    const uint32_t nr_entries = _fp_array.size();
+    uint32_t root = 0;
+    while (_fp_array[root].item != 0) root++;
+
+    // Root child heading the subtree of every position
+    std::vector<uint32_t> top(nr_entries, UINT32_MAX);
+    top[root] = root;
+    std::vector<uint32_t> path;
+    for (uint32_t i = 0; i < nr_entries; ++i) {
+        uint32_t pos = i;
+        while (top[pos] == UINT32_MAX && _fp_array[pos].parent_pos != (int32_t)root) {
+            path.push_back(pos);
+            pos = _fp_array[pos].parent_pos;
+        }
+        if (top[pos] == UINT32_MAX) top[pos] = pos;
+        for (uint32_t p : path) top[p] = top[pos];
+        path.clear();
+    }
+
+    // Bytes and walk work of every subtree, a position yields depth - 1 candidates per level
+    std::vector<uint64_t> bytes(nr_entries, 0);
+    std::vector<uint64_t> work(nr_entries, 0);
+    std::vector<uint32_t> subtrees;
+    for (uint32_t i = 0; i < nr_entries; ++i) {
+        if (i == root) continue;
+        if (top[i] == i) subtrees.push_back(i);
+        bytes[top[i]] += sizeof(PackedFPArrayEntry);
+        work[top[i]] += _fp_array[i].depth - 1;
+    }
+    std::sort(subtrees.begin(), subtrees.end(), [&](uint32_t a, uint32_t b) {
+        return work[a] != work[b] ? work[a] > work[b] : bytes[a] > bytes[b];
+    });
+
+    const uint64_t capacity = ALIGN_DOWN(mram_fp_array_capacity(), 8) - sizeof(PackedFPArrayEntry);
+    uint64_t total = 0;
+    for (uint32_t subtree : subtrees) {
+        if (bytes[subtree] > capacity) {
+            throw std::length_error("A root subtree of the FP-Array does not fit in the MRAM of one DPU");
+        }
+        total += bytes[subtree];
+    }
+
+    std::vector<uint32_t> shard_of_subtree(nr_entries, 0);
+    uint32_t nr_shards = (total + capacity - 1) / capacity;
+    for (;; ++nr_shards) {
+        if (nr_shards > rank_sizes.size()) {
+            throw std::length_error("FP-Array needs more shards than there are DPU ranks");
+        }
+        std::vector<uint64_t> shard_bytes(nr_shards, 0);
+        std::vector<uint64_t> shard_work(nr_shards, 0);
+        bool placed = true;
+        for (uint32_t subtree : subtrees) {
+            uint32_t best = nr_shards;
+            for (uint32_t s = 0; s < nr_shards; ++s) {
+                if (shard_bytes[s] + bytes[subtree] > capacity) continue;
+                if (best == nr_shards || shard_work[s] < shard_work[best]) best = s;
+            }
+            if (best == nr_shards) {
+                placed = false;
+                break;
+            }
+            shard_of_subtree[subtree] = best;
+            shard_bytes[best] += bytes[subtree];
+            shard_work[best] += work[subtree];
+        }
+        if (placed) break;
+    }
+
+    // Local positions, the root is position 0 of every shard
+    _shard_of.assign(nr_entries, 0);
+    _local_pos.assign(nr_entries, 0);
+    _shard_positions.assign(nr_shards, std::vector<uint32_t>(1, root));
+    for (uint32_t i = 0; i < nr_entries; ++i) {
+        if (i == root) continue;
+        uint32_t shard = shard_of_subtree[top[i]];
+        _shard_of[i] = shard;
+        _local_pos[i] = _shard_positions[shard].size();
+        _shard_positions[shard].push_back(i);
+    }
+
+    std::vector<std::vector<PackedFPArrayEntry>> shards(nr_shards);
+    for (uint32_t s = 0; s < nr_shards; ++s) {
+        shards[s].reserve(transfer_entries<PackedFPArrayEntry>(_shard_positions[s].size()));
+        for (uint32_t pos : _shard_positions[s]) {
+            const FPArrayEntry& entry = _fp_array[pos];
+            shards[s].push_back(pack_fp_array_entry(entry, pos == root ? -1 : (int32_t)_local_pos[entry.parent_pos]));
+        }
+        shards[s].resize(transfer_entries<PackedFPArrayEntry>(shards[s].size()), PackedFPArrayEntry {0, 0, 0});
+    }
+
+    // Shard s runs on ranks [s * R / S, (s + 1) * R / S)
+    _shard_first_dpu.assign(1, 0);
+    uint32_t dpu = 0;
+    for (uint32_t r = 0, s = 1; r < rank_sizes.size(); ++r) {
+        dpu += rank_sizes[r];
+        if (r + 1 == (size_t)s * rank_sizes.size() / nr_shards) {
+            _shard_first_dpu.push_back(dpu);
+            s++;
+        }
+    }
+    return shards;
+}
+
+// FP-array position of every local position of a DPU, nullptr when the DPUs hold the whole array
+const std::vector<uint32_t>* FPTree::dpu_positions(uint32_t dpu) const {
+    if (_shard_positions.empty()) return nullptr;
+    size_t shard = std::upper_bound(_shard_first_dpu.begin(), _shard_first_dpu.end(), dpu) - _shard_first_dpu.begin() - 1;
+    return &_shard_positions[shard];
+}
+
+// Split ele_pos into at most nr_parts ranges of similar candidate count, the work of an
+// entry is its depth - 1. A range holds at most max_entries entries and max_weight
+// candidates, so the returned range ends may stop short of ele_pos.size().
+static std::vector<size_t> split_by_depth(const std::vector<ElePosEntry>& ele_pos, const std::vector<FPArrayEntry>& fp_array,
+                                          size_t nr_parts, size_t max_entries, uint64_t max_weight) {
+    uint64_t remaining = 0;
+    for (const ElePosEntry& entry : ele_pos) {
+        if (entry.item != 0) remaining += fp_array[entry.pos].depth - 1;
+    }
+
+    std::vector<size_t> ends;
+    size_t end = 0;
+    for (size_t part = 0; part < nr_parts && end < ele_pos.size(); ++part) {
+        // Rebalance against what is left, earlier ranges may have been capped
+        uint64_t target = (remaining + (nr_parts - part) - 1) / (nr_parts - part);
+        uint64_t weight = 0;
+        size_t begin = end;
+        while (end < ele_pos.size() && end - begin < max_entries && (weight < target || end == begin)) {
+            const ElePosEntry& entry = ele_pos[end];
+            uint64_t entry_weight = entry.item != 0 ? fp_array[entry.pos].depth - 1 : 0;
+            if (end != begin && weight + entry_weight > max_weight) break;
+            weight += entry_weight;
+            end++;
+        }
+        remaining -= weight;
+        ends.push_back(end);
+    }
+    return ends;
+}
+
+// Route ele_pos[begin, end) to the DPUs of the shard owning each position, depth-balanced within
+// the shard. When a shard runs out of room the routed range stops at its first entry left out,
+// the later entries of the other shards then wait for the next partition as well.
+// Returns the end of the routed range.
+size_t FPTree::route_to_shards(const std::vector<ElePosEntry>& ele_pos, size_t begin, size_t end, uint64_t max_dpu_candidates,
+                               std::vector<std::vector<ElePosEntry>>& distributed) const {
+    const size_t nr_shards = _shard_positions.size();
+    std::vector<std::vector<ElePosEntry>> buckets(nr_shards);
+    std::vector<std::vector<size_t>> indices(nr_shards);
+    std::vector<std::vector<size_t>> ends(nr_shards);
+    while (true) {
+        for (size_t s = 0; s < nr_shards; ++s) {
+            buckets[s].clear();
+            indices[s].clear();
+        }
+        for (size_t i = begin; i < end; ++i) {
+            uint32_t shard = _shard_of[ele_pos[i].pos];
+            buckets[shard].push_back(ele_pos[i]);
+            indices[shard].push_back(i);
+        }
+
+        // Every shard routes at least its first entry, so the range never shrinks to nothing
+        size_t cut = end;
+        for (size_t s = 0; s < nr_shards; ++s) {
+            ends[s] = split_by_depth(buckets[s], _fp_array, _shard_first_dpu[s + 1] - _shard_first_dpu[s],
+                                     _mram.elepos_entries(), max_dpu_candidates);
+            size_t routed = ends[s].empty() ? 0 : ends[s].back();
+            if (routed < buckets[s].size()) cut = std::min(cut, indices[s][routed]);
+        }
+        if (cut == end) break;
+        end = cut;
+    }
+
+    for (size_t s = 0; s < nr_shards; ++s) {
+        for (size_t k = 0; k < ends[s].size(); ++k) {
+            size_t start = k == 0 ? 0 : ends[s][k - 1];
+            distributed[_shard_first_dpu[s] + k].assign(buckets[s].begin() + start, buckets[s].begin() + ends[s][k]);
+        }
+    }
+    return end;
+}
+
+static uint32_t table_bits_for(size_t nr_keys) {
+    uint32_t bits = MIN_TABLE_BITS;
+    while ((1ull << bits) < nr_keys * 2) {
+        bits++;
+    }
+    return bits;
+}
+
+// Depth-balanced ElePos ranges of every DPU for ele_pos[begin, ...), padded to the longest one of their rank
+PartitionUpload FPTree::prepare_partition(const std::vector<ElePosEntry>& ele_pos, size_t begin,
+                                          const std::vector<uint32_t>& rank_sizes, uint64_t max_dpu_candidates) {
     Timer::instance().start("Mine Freq Items - Preprocess");
-    int nr_of_dpus = system.dpus().size();
+    PartitionUpload upload;
+    int nr_of_dpus = 0;
+    for (uint32_t nr_rank_dpus : rank_sizes) nr_of_dpus += nr_rank_dpus;
+    size_t end = std::min<size_t>(ele_pos.size(), begin + _mram.elepos_entries() * nr_of_dpus);
 
     // Distribute ElePos across DPUs
-    std::cout << "ElePos size: " << ele_pos.size() * sizeof(ElePosEntry) / 1024.0 << " KB, distributing across " << nr_of_dpus << " DPUs." << std::endl;
-    std::vector<std::vector<ElePosEntry>> distributed;
-    int quotent = ele_pos.size() / nr_of_dpus;
-    int remainder = ele_pos.size() % nr_of_dpus;
-    
-    int max_candidates = 0;
-    std::vector<int> candidate_cnts(nr_of_dpus, 0);
-    for (int i = 0; i < nr_of_dpus; ++i) {
-        int start = i * quotent + std::min(i, remainder);
-        int end = start + quotent + (i < remainder ? 1 : 0);
-        distributed.push_back(std::vector<ElePosEntry>(ele_pos.begin() + start, ele_pos.begin() + end));
-
-        // TODO: Consider this logic to be moved to the DPU code
-        int candidate_start_idx = 0;
-        for (int j = 0; j < (int)distributed.back().size(); ++j) {
-            distributed.back()[j].candidate_start_idx = candidate_start_idx;
-            if (distributed.back()[j].item == 0) continue;
-            candidate_start_idx += _fp_array[distributed.back()[j].pos].depth - 1;
+    std::cout << "ElePos size: " << (end - begin) * sizeof(ElePosEntry) / 1024.0 << " KB, distributing across " << nr_of_dpus << " DPUs." << std::endl;
+    std::vector<std::vector<ElePosEntry>> distributed(nr_of_dpus);
+    if (_shard_positions.empty()) {
+        std::vector<ElePosEntry> range(ele_pos.begin() + begin, ele_pos.begin() + end);
+        // Depth-balanced ranges, so every DPU walks about the same number of candidates
+        std::vector<size_t> ends = split_by_depth(range, _fp_array, nr_of_dpus, _mram.elepos_entries(), max_dpu_candidates);
+        for (size_t i = 0; i < ends.size(); ++i) {
+            size_t start = i == 0 ? 0 : ends[i - 1];
+            distributed[i].assign(range.begin() + start, range.begin() + ends[i]);
         }
-        candidate_cnts[i] = candidate_start_idx;
-        max_candidates = std::max(max_candidates, candidate_start_idx);
+        upload.end = begin + (ends.empty() ? 0 : ends.back());
+    } else {
+        upload.end = route_to_shards(ele_pos, begin, end, max_dpu_candidates, distributed);
     }
 
-    std::vector<std::vector<uint32_t>> counts(nr_of_dpus, std::vector<uint32_t>(1, 0));
+    upload.counts.assign(nr_of_dpus, std::vector<uint32_t>(1, 0));
     for (int i = 0; i < nr_of_dpus; ++i) {
-        counts[i][0] = distributed[i].size();
-        int padding = distributed[0].size() - distributed[i].size();
-        if (padding > 0) {
-            distributed[i].resize(distributed[i].size() + padding, {0, 0, 0, 0}); // Pad with zeros
+        upload.counts[i][0] = distributed[i].size();
+
+        uint64_t nr_candidates = 0;
+        for (ElePosEntry& entry : distributed[i]) {
+            if (entry.item != 0) nr_candidates += _fp_array[entry.pos].depth - 1;
+            if (!_shard_positions.empty()) entry.pos = _local_pos[entry.pos];
         }
+        upload.max_candidates = std::max(upload.max_candidates, nr_candidates);
     }
+    upload.distributed = group_by_rank(rank_sizes, std::move(distributed), ElePosEntry {0, 0, 0, 0}); // Pad with zeros
     Timer::instance().stop();
 
-    Timer::instance().start("Mine Freq Items - Transfer kElePos(To DPU)");
-    system.copy("k_elepos_size", counts);
-    system.copy(DPU_MRAM_HEAP_POINTER_NAME, MRAM_FP_ARRAY_SZ, distributed);
-    Timer::instance().stop();
+    return upload;
+}
+
+// Run every partition of ele_pos through the DPUs. configure() sets the kernel variables of a
+// partition, read_back() copies its results into the host buffer of one of two slots and
+// merge() consumes a slot. With async launches a partition is prepared while the previous one
+// executes and merged while the next one executes, the DPUs only wait for read_back().
+void FPTree::run_partitions(dpu::DpuSet& system, const std::vector<ElePosEntry>& ele_pos, uint64_t max_dpu_candidates,
+                            const std::function<void(const PartitionUpload&)>& configure,
+                            const std::function<void(const PartitionUpload&, int)>& read_back,
+                            const std::function<void(int)>& merge) {
+    std::vector<uint32_t> rank_sizes = dpus_per_rank(system);
+    auto launch = [&](const PartitionUpload& upload) {
+        Timer::instance().start("Mine Freq Items - Transfer kElePos(To DPU)");
+        configure(upload);
+        system.copy("elepos_slot", std::vector<uint32_t>(1, 0));
+        system.async().copy("k_elepos_size", upload.counts);
+        push_ragged(system, DPU_MRAM_HEAP_POINTER_NAME, _mram.elepos_offset, upload.distributed);
+        if (_async_launch) {
+            system.async().exec();
+        } else {
+            system.async().sync();
+        }
+        Timer::instance().stop();
+
+        if (!_async_launch) {
+            Timer::instance().start("Mine Freq Items - Exec");
+            system.exec();
+            Timer::instance().stop();
+        }
+    };
+
+    if (ele_pos.empty()) return;
+    PartitionUpload current = prepare_partition(ele_pos, 0, rank_sizes, max_dpu_candidates);
+    launch(current);
+    for (int slot = 0;; slot ^= 1) {
+        // A partition may be only partly consumed when the depth split hits a per-DPU capacity
+        bool more = current.end < ele_pos.size();
+        PartitionUpload next;
+        if (more) {
+            next = prepare_partition(ele_pos, current.end, rank_sizes, max_dpu_candidates);
+        }
 
-    Timer::instance().start("Mine Freq Items - Exec");
-    system.exec();
+        if (_async_launch) {
+            Timer::instance().start("Mine Freq Items - Exec");
+            system.async().sync();
+            Timer::instance().stop();
+        }
+        read_back(current, slot);
+        if (more) {
+            launch(next);
+        }
+        merge(slot);
+
+        if (!more) break;
+        current = std::move(next);
+    }
+}
+
+// Broadcast the keys reaching min_support as an open-addressing set, probed like the phase 1 table
+uint64_t FPTree::broadcast_key_set(dpu::DpuSet& system, const CandidateTable& candidates) {
+    Timer::instance().start("Mine Freq Items - Preprocess");
+    size_t nr_frequent = 0;
+    for (const CandidateTable::Slot& slot : candidates.slots()) {
+        if (slot.key != CANDIDATE_EMPTY_KEY && (int)slot.support >= _min_support) nr_frequent++;
+    }
+
+    _key_set_bits = table_bits_for(nr_frequent);
+    std::vector<uint64_t> key_set(1ull << _key_set_bits, DPU_EMPTY_KEY);
+    uint32_t mask = key_set.size() - 1;
+    for (const CandidateTable::Slot& slot : candidates.slots()) {
+        if (slot.key == CANDIDATE_EMPTY_KEY || (int)slot.support < _min_support) continue;
+        uint32_t idx = dpu_key_hash(slot.key) & mask;
+        while (key_set[idx] != DPU_EMPTY_KEY) {
+            idx = (idx + 1) & mask;
+        }
+        key_set[idx] = slot.key;
+    }
+
+    // Whatever the key set leaves of the candidate region holds the emitted candidates
+    size_t key_set_bytes = key_set.size() * sizeof(uint64_t);
+    uint64_t max_dpu_candidates = key_set_bytes < _mram.candidate_size ? (_mram.candidate_size - key_set_bytes) / sizeof(CandidateEntry) : 0;
+    if (max_dpu_candidates < NR_DB_ITEMS) {
+        throw std::runtime_error("Frequent key set does not fit in MRAM");
+    }
     Timer::instance().stop();
 
-    Timer::instance().start("Mine Freq Items - Transfer Candidates(To CPU)");
-    std::vector<std::vector<CandidateEntry>> candidates(nr_of_dpus, std::vector<CandidateEntry>(max_candidates));
-    system.copy(candidates, DPU_MRAM_HEAP_POINTER_NAME, MRAM_FP_ARRAY_SZ + MRAM_FP_ELEPOS_SZ);
+    Timer::instance().start("Mine Freq Items - Transfer Key Set(To DPU)");
+    system.copy("table_bits", std::vector<uint32_t>(1, _key_set_bits));
+    system.copy(DPU_MRAM_HEAP_POINTER_NAME, _mram.candidate_offset, key_set);
     Timer::instance().stop();
 
+    return std::min<uint64_t>(max_dpu_candidates, _mram.max_dpu_candidates());
+}
+
+// First entry of the tail of ele_pos the host walks, about _cpu_share of the candidate weight
+size_t FPTree::split_for_cpu(const std::vector<ElePosEntry>& ele_pos, uint64_t& cpu_weight, uint64_t& dpu_weight) const {
+    uint64_t total = candidate_weight(ele_pos);
+    uint64_t target = total * _cpu_share;
+    size_t begin = ele_pos.size();
+    cpu_weight = 0;
+    while (begin > 0 && cpu_weight < target) {
+        --begin;
+        if (ele_pos[begin].item != 0) cpu_weight += _fp_array[ele_pos[begin].pos].depth - 1;
+    }
+    dpu_weight = total - cpu_weight;
+    return begin;
+}
+
+// Same walk as phase 1 of the kernel: supports of every key
+void FPTree::cpu_count_keys(const std::vector<ElePosEntry>& ele_pos, size_t begin, size_t end, CpuWalk& walk) const {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = begin; i < end; ++i) {
+        const ElePosEntry& entry = ele_pos[i];
+        if (entry.item == 0) continue;
+        uint32_t pos = _fp_array[entry.pos].parent_pos;
+        while (_fp_array[pos].item != 0) {
+            walk.supports.add_support(dpu_make_key(entry.item, _fp_array[pos].item), entry.support);
+            pos = _fp_array[pos].parent_pos;
+        }
+    }
+    walk.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Same walk as phase 2 of the kernel: positions of the keys that are frequent over the whole batch
+void FPTree::cpu_collect_candidates(const std::vector<ElePosEntry>& ele_pos, size_t begin, size_t end,
+                                    const CandidateTable& candidates, CpuWalk& walk) const {
+    for (size_t i = begin; i < end; ++i) {
+        const ElePosEntry& entry = ele_pos[i];
+        if (entry.item == 0) continue;
+        uint32_t pos = _fp_array[entry.pos].parent_pos;
+        while (_fp_array[pos].item != 0) {
+            const CandidateTable::Slot* slot = candidates.find(dpu_make_key(entry.item, _fp_array[pos].item));
+            if (slot && (int)slot->support >= _min_support) {
+                walk.candidates.push_back({entry.item, _fp_array[pos].item, pos, entry.support});
+            }
+            pos = _fp_array[pos].parent_pos;
+        }
+    }
+}
+
+// Supports and positions of every key of the batch, merged and finalized in candidate_table
+void FPTree::mine_candidates(dpu::DpuSet& system, const std::vector<ElePosEntry>& all_ele_pos, CandidateTable& candidate_table) {
+    int nr_of_dpus = system.dpus().size();
+
+    // Host threads walk the tail of the batch while the DPUs run phase 1 on the rest
+    uint64_t cpu_weight = 0;
+    uint64_t dpu_weight = 0;
+    size_t cpu_begin = _cpu_share > 0 ? split_for_cpu(all_ele_pos, cpu_weight, dpu_weight) : all_ele_pos.size();
+    std::vector<ElePosEntry> dpu_part;
+    if (cpu_begin < all_ele_pos.size()) {
+        dpu_part.assign(all_ele_pos.begin(), all_ele_pos.begin() + cpu_begin);
+    }
+    const std::vector<ElePosEntry>& ele_pos = cpu_begin < all_ele_pos.size() ? dpu_part : all_ele_pos;
+
+    // Outlives the walkers, phase 2 on the host reads it
+    candidate_table.clear();
+    // One walker per core, the calling thread only waits on the DPUs
+    int nr_cpu_threads = std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : NR_THREADS;
+    size_t cpu_size = all_ele_pos.size() - cpu_begin;
+    std::vector<CpuWalk> cpu_walks(cpu_size > 0 ? nr_cpu_threads : 0);
+    std::vector<std::thread> cpu_threads;
+    auto start_cpu_threads = [&](auto&& walk) {
+        for (int t = 0; t < nr_cpu_threads && cpu_size > 0; ++t) {
+            size_t begin = cpu_begin + cpu_size * t / nr_cpu_threads;
+            size_t end = cpu_begin + cpu_size * (t + 1) / nr_cpu_threads;
+            cpu_threads.emplace_back([walk, &cpu_walks, t, begin, end]() {
+                walk(begin, end, cpu_walks[t]);
+            });
+        }
+    };
+    auto count_keys = [this, &all_ele_pos](size_t begin, size_t end, CpuWalk& walk) {
+        cpu_count_keys(all_ele_pos, begin, end, walk);
+    };
+    start_cpu_threads(count_keys);
+    // A DPU error must not leave the walkers running
+    struct JoinGuard {
+        std::vector<std::thread>& threads;
+        ~JoinGuard() {
+            for (std::thread& thread : threads) {
+                if (thread.joinable()) thread.join();
+            }
+        }
+    } join_guard {cpu_threads};
+
+    std::vector<uint32_t> nr_out[2];
+    std::vector<std::vector<KeySupportEntry>> keys[2];
+    std::vector<std::vector<CandidateEntry>> candidates[2];
+    auto read_nr_out = [&](int slot) {
+        Timer::instance().start("Mine Freq Items - Transfer Candidates(To CPU)");
+        std::vector<std::vector<uint32_t>> counts(nr_of_dpus, std::vector<uint32_t>(1));
+        system.copy(counts, "nr_out");
+        nr_out[slot].resize(nr_of_dpus);
+        for (int i = 0; i < nr_of_dpus; ++i) {
+            nr_out[slot][i] = counts[i][0];
+        }
+        Timer::instance().stop();
+    };
+
+    // Phase 1: supports of every key, only the aggregated keys come back
+    uint32_t table_bits = MIN_TABLE_BITS;
+    auto dpu_start = std::chrono::steady_clock::now();
+    run_partitions(system, ele_pos, _mram.max_dpu_candidates(),
+        [&](const PartitionUpload& upload) {
+            // A DPU never holds more distinct keys than candidates
+            table_bits = table_bits_for(upload.max_candidates);
+            system.copy("mine_phase", std::vector<uint32_t>(1, MINE_PHASE_COUNT));
+            system.copy("table_bits", std::vector<uint32_t>(1, table_bits));
+        },
+        [&](const PartitionUpload&, int slot) {
+            read_nr_out(slot);
+            Timer::instance().start("Mine Freq Items - Transfer Candidates(To CPU)");
+            keys[slot] = gather_ragged<KeySupportEntry>(system, DPU_MRAM_HEAP_POINTER_NAME,
+                                                        _mram.candidate_offset + (sizeof(KeySupportEntry) << table_bits), nr_out[slot]);
+            Timer::instance().stop();
+        },
+        [&](int slot) {
+            Timer::instance().start("Mine Freq Items - Postprocess");
+            for (int i = 0; i < nr_of_dpus; ++i) {
+                for (uint32_t j = 0; j < nr_out[slot][i]; ++j) {
+                    candidate_table.add_support(keys[slot][i][j].key, keys[slot][i][j].support);
+                }
+            }
+            Timer::instance().stop();
+        });
+
+    double dpu_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - dpu_start).count();
+
+    if (!cpu_threads.empty()) {
+        Timer::instance().start("Mine Freq Items - Wait CPU");
+        double cpu_seconds = 0;
+        for (int t = 0; t < (int)cpu_threads.size(); ++t) {
+            cpu_threads[t].join();
+            cpu_seconds = std::max(cpu_seconds, cpu_walks[t].seconds);
+        }
+        Timer::instance().stop();
+
+        Timer::instance().start("Mine Freq Items - Postprocess");
+        for (const CpuWalk& walk : cpu_walks) {
+            for (const CandidateTable::Slot& key_slot : walk.supports.slots()) {
+                if (key_slot.key != CANDIDATE_EMPTY_KEY) candidate_table.add_support(key_slot.key, key_slot.support);
+            }
+        }
+        Timer::instance().stop();
+
+        // Next batch gets the share at which both sides would have finished phase 1 together
+        if (cpu_weight > 0 && dpu_weight > 0 && cpu_seconds > 0 && dpu_seconds > 0) {
+            double cpu_rate = cpu_weight / cpu_seconds;
+            double dpu_rate = dpu_weight / dpu_seconds;
+            double share = cpu_rate / (cpu_rate + dpu_rate);
+            _cpu_share = std::clamp((_cpu_share + share) / 2, HYBRID_MIN_CPU_SHARE, HYBRID_MAX_CPU_SHARE);
+        }
+    }
+
+    // Phase 2: positions of the frequent keys only, the host threads collect theirs meanwhile
+    uint64_t max_dpu_candidates = broadcast_key_set(system, candidate_table);
+    cpu_threads.clear();
+    auto collect_candidates = [this, &all_ele_pos, &candidate_table](size_t begin, size_t end, CpuWalk& walk) {
+        cpu_collect_candidates(all_ele_pos, begin, end, candidate_table, walk);
+    };
+    start_cpu_threads(collect_candidates);
+    run_partitions(system, ele_pos, max_dpu_candidates,
+        [&](const PartitionUpload&) {
+            system.copy("mine_phase", std::vector<uint32_t>(1, MINE_PHASE_COLLECT));
+        },
+        [&](const PartitionUpload&, int slot) {
+            read_nr_out(slot);
+            Timer::instance().start("Mine Freq Items - Transfer Candidates(To CPU)");
+            candidates[slot] = gather_ragged<CandidateEntry>(system, DPU_MRAM_HEAP_POINTER_NAME,
+                                                             _mram.candidate_offset + (sizeof(uint64_t) << _key_set_bits), nr_out[slot]);
+            Timer::instance().stop();
+        },
+        [&](int slot) {
+            Timer::instance().start("Mine Freq Items - Postprocess");
+            uint64_t nr_received = 0;
+            for (int i = 0; i < nr_of_dpus; ++i) {
+                nr_received += nr_out[slot][i];
+            }
+            candidate_table.reserve(nr_received);
+            for (int i = 0; i < nr_of_dpus; ++i) {
+                const std::vector<uint32_t>* positions = dpu_positions(i);
+                for (uint32_t j = 0; j < nr_out[slot][i]; ++j) {
+                    const CandidateEntry& candidate = candidates[slot][i][j];
+                    uint32_t pos = positions ? (*positions)[candidate.suffix_item_pos] : candidate.suffix_item_pos;
+                    candidate_table.add_position(dpu_make_key(candidate.prefix_item, candidate.suffix_item), pos, candidate.support);
+                }
+            }
+            Timer::instance().stop();
+        });
+
+    if (!cpu_threads.empty()) {
+        Timer::instance().start("Mine Freq Items - Wait CPU");
+        for (std::thread& thread : cpu_threads) {
+            thread.join();
+        }
+        Timer::instance().stop();
+    }
+
     Timer::instance().start("Mine Freq Items - Postprocess");
-    // size_t total_candidates = 0;
-    // for (int i = 0; i < nr_of_dpus; ++i) {
-    //     total_candidates += candidate_cnts[i];
-    // }
+    for (const CpuWalk& walk : cpu_walks) {
+        candidate_table.reserve(walk.candidates.size());
+        for (const CandidateEntry& candidate : walk.candidates) {
+            candidate_table.add_position(dpu_make_key(candidate.prefix_item, candidate.suffix_item),
+                                         candidate.suffix_item_pos, candidate.support);
+        }
+    }
+    candidate_table.finalize();
+    Timer::instance().stop();
+}
 
-    // candidate_map.reserve(candidate_map.size() + total_candidates);
+// Copy the resident ElePos of slot back to the host, grouped by itemset like a host-built level
+std::vector<ElePosEntry> FPTree::pull_resident_ele_pos(dpu::DpuSet& system, uint32_t slot, const std::vector<uint32_t>& counts) {
+    Timer::instance().start("Mine Freq Items - Transfer kElePos(To CPU)");
+    std::vector<std::vector<ElePosEntry>> buffers = gather_ragged<ElePosEntry>(system, DPU_MRAM_HEAP_POINTER_NAME,
+                                                                               _mram.elepos_offset + slot * _mram.elepos_slot_size, counts);
+    Timer::instance().stop();
 
-    for (int i = 0; i < nr_of_dpus; ++i) {
-        for (int j = 0; j < candidate_cnts[i]; ++j) {
-            const CandidateEntry& candidate = candidates[i][j];
-            if (candidate.suffix_item == 0) continue; // Skip root item
-            uint64_t key = (static_cast<uint64_t>(candidate.prefix_item) << 32) | candidate.suffix_item;
-
-            auto it = candidate_map.try_emplace(key, candidate);
-            if (!it.second) {
-                it.first->second.add_candidate(candidate);
+    Timer::instance().start("Mine Freq Items - Postprocess");
+    std::vector<ElePosEntry> ele_pos;
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        if (const std::vector<uint32_t>* positions = dpu_positions(i)) {
+            for (uint32_t j = 0; j < counts[i]; ++j) {
+                buffers[i][j].pos = (*positions)[buffers[i][j].pos];
             }
         }
+        ele_pos.insert(ele_pos.end(), buffers[i].begin(), buffers[i].begin() + counts[i]);
     }
+    std::sort(ele_pos.begin(), ele_pos.end(), [](const ElePosEntry& a, const ElePosEntry& b) {
+        return a.item != b.item ? a.item < b.item : a.pos < b.pos;
+    });
     Timer::instance().stop();
+    return ele_pos;
 }
 
-std::unordered_map<uint64_t, TempCandidates> FPTree::mine_candidates(dpu::DpuSet& system, const std::vector<ElePosEntry>& ele_pos) {
+// Mine levels with the ElePos kept in MRAM. Per level the host only receives the key supports,
+// broadcasts the frequent keys with their itemset ids and reads back the next-level counts.
+// Stops when a level no longer fits the two ElePos slots, ele_pos then holds that level for the
+// usual host-driven mining, otherwise it is left empty.
+void FPTree::mine_resident(dpu::DpuSet& system, std::vector<ElePosEntry>& ele_pos) {
+    const uint64_t slot_entries = _mram.slot_entries();
     int nr_of_dpus = system.dpus().size();
-    std::unordered_map<uint64_t, TempCandidates> candidate_map;
-    
-    int max_elepos = (MRAM_FP_ELEPOS_SZ / sizeof(ElePosEntry)) * nr_of_dpus;
-    for (int partition = 0; partition < (int)ele_pos.size(); partition += max_elepos) {
-        int end = std::min(static_cast<int>(ele_pos.size()), partition + max_elepos);
-        std::vector<ElePosEntry> ele_pos_partition(ele_pos.begin() + partition, ele_pos.begin() + end);
+    PartitionUpload upload = prepare_partition(ele_pos, 0, dpus_per_rank(system), _mram.max_dpu_candidates());
+    std::vector<uint32_t> counts(nr_of_dpus);
+    for (int i = 0; i < nr_of_dpus; ++i) {
+        counts[i] = upload.counts[i][0];
+        if (counts[i] > slot_entries) return;
+    }
+    if (upload.end < ele_pos.size()) return;
 
-        dpu_mine_candidates(system, ele_pos_partition, candidate_map);
+    Timer::instance().start("Mine Freq Items - Transfer kElePos(To DPU)");
+    push_ragged(system, DPU_MRAM_HEAP_POINTER_NAME, _mram.elepos_offset, upload.distributed);
+    system.async().sync();
+    Timer::instance().stop();
+    uint64_t max_weight = upload.max_candidates;
+    upload = PartitionUpload();
+    ele_pos = std::vector<ElePosEntry>();
+
+    uint32_t slot = 0;
+    CandidateTable key_supports;
+    while (std::any_of(counts.begin(), counts.end(), [](uint32_t count) { return count > 0; })) {
+        // Every walked candidate may become a next-level ElePos
+        if (max_weight > std::min<uint64_t>(slot_entries, _mram.max_dpu_candidates())) {
+            ele_pos = pull_resident_ele_pos(system, slot, counts);
+            return;
+        }
+
+        // Phase 1
+        std::vector<std::vector<uint32_t>> sizes(nr_of_dpus, std::vector<uint32_t>(1));
+        for (int i = 0; i < nr_of_dpus; ++i) {
+            sizes[i][0] = counts[i];
+        }
+        uint32_t table_bits = table_bits_for(max_weight);
+        Timer::instance().start("Mine Freq Items - Exec");
+        system.copy("mine_phase", std::vector<uint32_t>(1, MINE_PHASE_COUNT));
+        system.copy("table_bits", std::vector<uint32_t>(1, table_bits));
+        system.copy("elepos_slot", std::vector<uint32_t>(1, slot));
+        system.copy("k_elepos_size", sizes);
+        system.exec();
+        Timer::instance().stop();
+
+        Timer::instance().start("Mine Freq Items - Transfer Candidates(To CPU)");
+        system.copy(sizes, "nr_out");
+        std::vector<uint32_t> nr_keys(nr_of_dpus);
+        for (int i = 0; i < nr_of_dpus; ++i) {
+            nr_keys[i] = sizes[i][0];
+        }
+        std::vector<std::vector<KeySupportEntry>> keys = gather_ragged<KeySupportEntry>(system, DPU_MRAM_HEAP_POINTER_NAME,
+                                                             _mram.candidate_offset + (sizeof(KeySupportEntry) << table_bits), nr_keys);
+        Timer::instance().stop();
+
+        // Frequent keys become itemsets, the key set maps them to their ids
+        Timer::instance().start("Mine Freq Items - Merge Results");
+        key_supports.clear();
+        for (int i = 0; i < nr_of_dpus; ++i) {
+            for (uint32_t j = 0; j < nr_keys[i]; ++j) {
+                key_supports.add_support(keys[i][j].key, keys[i][j].support);
+            }
+        }
+        std::vector<KeySupportEntry> frequent;
+        for (const CandidateTable::Slot& slot : key_supports.slots()) {
+            if (slot.key == CANDIDATE_EMPTY_KEY || (int)slot.support < _min_support) continue;
+            _frequent_itemsets_gt1.push_back({CandidateTable::prefix_of(slot.key), CandidateTable::suffix_of(slot.key)});
+            _frequent_supports_gt1.push_back(slot.support);
+            frequent.push_back({slot.key, _itemset_id++, 0});
+        }
+        Timer::instance().stop();
+        if (frequent.empty()) return;
+
+        Timer::instance().start("Mine Freq Items - Preprocess");
+        uint32_t key_set_bits = table_bits_for(frequent.size());
+        std::vector<KeySupportEntry> key_set(1ull << key_set_bits, KeySupportEntry {DPU_EMPTY_KEY, 0, 0});
+        if (key_set.size() * sizeof(KeySupportEntry) > _mram.candidate_size) {
+            throw std::runtime_error("Frequent key set does not fit in MRAM");
+        }
+        uint32_t mask = key_set.size() - 1;
+        for (const KeySupportEntry& entry : frequent) {
+            uint32_t idx = dpu_key_hash(entry.key) & mask;
+            while (key_set[idx].key != DPU_EMPTY_KEY) {
+                idx = (idx + 1) & mask;
+            }
+            key_set[idx] = entry;
+        }
+        Timer::instance().stop();
+
+        Timer::instance().start("Mine Freq Items - Transfer Key Set(To DPU)");
+        system.copy("table_bits", std::vector<uint32_t>(1, key_set_bits));
+        system.copy(DPU_MRAM_HEAP_POINTER_NAME, _mram.candidate_offset, key_set);
+        Timer::instance().stop();
+
+        // Phase 2 writes the next level into the other slot
+        Timer::instance().start("Mine Freq Items - Exec");
+        system.copy("mine_phase", std::vector<uint32_t>(1, MINE_PHASE_RESIDENT));
+        system.exec();
+        Timer::instance().stop();
+
+        Timer::instance().start("Mine Freq Items - Transfer Candidates(To CPU)");
+        std::vector<std::vector<uint64_t>> weights(nr_of_dpus, std::vector<uint64_t>(1));
+        system.copy(sizes, "nr_out");
+        system.copy(weights, "next_weight");
+        max_weight = 0;
+        for (int i = 0; i < nr_of_dpus; ++i) {
+            counts[i] = sizes[i][0];
+            max_weight = std::max(max_weight, weights[i][0]);
+        }
+        Timer::instance().stop();
+        slot ^= 1;
+    }
+}
+
+// Upper bound of the candidates walked for ele_pos, every entry yields depth - 1 of them
+uint64_t FPTree::candidate_weight(const std::vector<ElePosEntry>& ele_pos) const {
+    uint64_t weight = 0;
+    for (const ElePosEntry& entry : ele_pos) {
+        if (entry.item != 0) weight += _fp_array[entry.pos].depth - 1;
+    }
+    return weight;
+}
+
+// Move the entries of the upper half of the itemset ids, by candidate weight, from batch to rest.
+// Candidate keys are partitioned by their prefix itemset, so both halves mine exactly
+// what the whole batch would have. Returns false if the batch holds a single itemset.
+bool FPTree::split_batch(std::vector<ElePosEntry>& batch, std::vector<ElePosEntry>& rest) const {
+    uint32_t min_id = UINT32_MAX, max_id = 0;
+    for (const ElePosEntry& entry : batch) {
+        if (entry.item == 0) continue;
+        min_id = std::min(min_id, entry.item);
+        max_id = std::max(max_id, entry.item);
+    }
+    if (min_id >= max_id) return false;
+
+    std::vector<uint64_t> id_weight(max_id - min_id + 1, 0);
+    uint64_t total = 0;
+    for (const ElePosEntry& entry : batch) {
+        if (entry.item == 0) continue;
+        id_weight[entry.item - min_id] += _fp_array[entry.pos].depth - 1;
+        total += _fp_array[entry.pos].depth - 1;
+    }
+    uint32_t split_id = min_id + 1;
+    uint64_t weight = id_weight[0];
+    while (split_id < max_id && weight + id_weight[split_id - min_id] <= total / 2) {
+        weight += id_weight[split_id++ - min_id];
     }
 
-    return candidate_map;
+    rest.clear();
+    size_t kept = 0;
+    for (const ElePosEntry& entry : batch) {
+        if (entry.item >= split_id) {
+            rest.push_back(entry);
+        } else {
+            batch[kept++] = entry;
+        }
+    }
+    batch.resize(kept);
+    return true;
 }
 
 void FPTree::mine_frequent_itemsets() {
     try {
-        dpu::DpuSet system = dpu::DpuSet::allocate(NR_DPUS, DPU_CONFIG);
-        Timer::instance().start("Mine Freq Items - DPU Load");
-        system.load(DPU_MINE_CANDIDATES);
+        dpu::DpuSet& system = DpuResources::instance().acquire(DPU_MINE_CANDIDATES);
+
+        // The DPUs get the packed entries, the host keeps the full ones for the weights and the CPU walk.
+        // An FP-array too large for one DPU is split into shards of root subtrees, one per group of ranks.
+        Timer::instance().start("Mine Freq Items - Preprocess");
+        std::vector<std::vector<PackedFPArrayEntry>> shards;
+        _shard_positions.clear();
+        if (_fp_array.size() * sizeof(PackedFPArrayEntry) > mram_fp_array_capacity()) {
+            shards = shard_fp_array(dpus_per_rank(system));
+        } else {
+            shards.emplace_back(transfer_entries<PackedFPArrayEntry>(_fp_array.size()), PackedFPArrayEntry {0, 0, 0});
+            for (size_t i = 0; i < _fp_array.size(); ++i) {
+                shards[0][i] = pack_fp_array_entry(_fp_array[i], _fp_array[i].parent_pos);
+            }
+        }
+        uint64_t fp_array_bytes = 0;
+        for (const std::vector<PackedFPArrayEntry>& shard : shards) {
+            fp_array_bytes = std::max<uint64_t>(fp_array_bytes, shard.size() * sizeof(PackedFPArrayEntry));
+        }
+        _mram = plan_mram_layout(fp_array_bytes, candidate_weight(_k1_ele_pos), _k1_ele_pos.size());
         Timer::instance().stop();
+        std::cout << "MRAM layout: FP-Array " << _mram.elepos_offset / 1024.0 << " KB in " << shards.size() << " shard(s), ElePos "
+                  << 2 * _mram.elepos_slot_size / 1024.0 << " KB, candidates " << _mram.candidate_size / 1024.0 << " KB" << std::endl;
 
         Timer::instance().start("Mine Freq Items - Transfer FP Array(To DPU)");
-        system.copy(DPU_MRAM_HEAP_POINTER_NAME, _fp_array);
+        if (shards.size() == 1) {
+            system.copy(DPU_MRAM_HEAP_POINTER_NAME, shards[0]);
+        } else {
+            // Ranks load their shards in parallel, the shards must live until the sync
+            std::vector<dpu::DpuSet*>& ranks = system.ranks();
+            for (size_t s = 0; s < shards.size(); ++s) {
+                for (size_t r = s * ranks.size() / shards.size(); r < (s + 1) * ranks.size() / shards.size(); ++r) {
+                    ranks[r]->async().copy(DPU_MRAM_HEAP_POINTER_NAME, shards[s]);
+                }
+            }
+            system.async().sync();
+        }
+        shards = std::vector<std::vector<PackedFPArrayEntry>>();
+        system.copy("elepos_offset", std::vector<uint32_t>(1, _mram.elepos_offset));
+        system.copy("elepos_slot_size", std::vector<uint32_t>(1, _mram.elepos_slot_size));
+        system.copy("candidate_offset", std::vector<uint32_t>(1, _mram.candidate_offset));
         Timer::instance().stop();
 
-        std::vector<ElePosEntry> ele_pos = _k1_ele_pos;
-        while (ele_pos.size() > 0) {
-            auto candidates = std::move(mine_candidates(system, ele_pos));
+        // Without a budget the stack holds one whole level at a time, which is the breadth-first order.
+        // A batch over budget is split by itemset id and its halves are mined depth-first,
+        // every batch still spans all DPUs.
+        std::vector<std::vector<ElePosEntry>> pending;
+        CandidateTable candidates; // Reused by every batch, keeps its capacity
+        pending.push_back(_k1_ele_pos);
+        if (_resident) {
+            mine_resident(system, pending.back());
+        }
+        while (!pending.empty()) {
+            std::vector<ElePosEntry> ele_pos = std::move(pending.back());
+            pending.pop_back();
+            if (ele_pos.empty()) continue;
+
+            if (_mem_budget > 0 && candidate_weight(ele_pos) * CANDIDATE_FOOTPRINT > _mem_budget) {
+                std::vector<ElePosEntry> rest;
+                if (split_batch(ele_pos, rest)) {
+                    pending.push_back(std::move(rest));
+                    pending.push_back(std::move(ele_pos));
+                    continue;
+                }
+            }
+
+            mine_candidates(system, ele_pos, candidates);
+            ele_pos = std::vector<ElePosEntry>();
 
             Timer::instance().start("Mine Freq Items - Merge Results");
             std::vector<ElePosEntry> next_ele_pos;
-            for (const auto& [key, candidate_set] : candidates) {
-                if ((int)candidate_set.get_support() >= _min_support) {
-                    uint32_t prefix_item = candidate_set.get_prefix_item();
-                    _frequent_itemsets_gt1.push_back({prefix_item, candidate_set.get_suffix_item()});
-                    
-                    uint32_t itemset_id = _itemset_id++;
-                    for (const auto& candidate : candidate_set.candidates) {
-                        next_ele_pos.emplace_back(ElePosEntry {
-                            itemset_id,
-                            candidate.suffix_item_pos,
-                            candidate.support,
-                            0
-                        });
-                    }
+            next_ele_pos.reserve(candidates.nr_positions());
+            for (const CandidateTable::Slot& slot : candidates.slots()) {
+                if (slot.key == CANDIDATE_EMPTY_KEY || (int)slot.support < _min_support) continue;
+                _frequent_itemsets_gt1.push_back({CandidateTable::prefix_of(slot.key), CandidateTable::suffix_of(slot.key)});
+                _frequent_supports_gt1.push_back(slot.support);
+
+                uint32_t itemset_id = _itemset_id++;
+                const CandidatePos* positions = candidates.positions(slot);
+                for (uint32_t i = 0; i < slot.count; ++i) {
+                    next_ele_pos.emplace_back(ElePosEntry {
+                        itemset_id,
+                        positions[i].suffix_item_pos,
+                        positions[i].support,
+                        0
+                    });
                 }
             }
-            ele_pos.swap(next_ele_pos);
+            pending.push_back(std::move(next_ele_pos));
             Timer::instance().stop();
         }
     } catch (const dpu::DpuError& e) {
+        Timer::instance().discard();
         std::cerr << "DPU error: " << e.what() << std::endl;
+        throw;
+    } catch (const std::exception& e) {
+        Timer::instance().discard();
+        std::cerr << "Error: " << e.what() << std::endl;
+        throw;
     }
 }
 
@@ -5,29 +5,75 @@
 #include <filesystem>
 #include <string>
 #include <functional>
+#include <cstring>
 
+#include "dpu_resources.h"
 #include "timer.h"
+#include "itemset_trie.h"
 
 int main(int argc, char* argv[]) {
     if (argc < 4) {
-        printf("Usage: %s <data_file> <min_support> <output_file>\n", argv[0]);
+        printf("Usage: %s <data_file> <min_support> <output_file> [--output-format text|trie] [--mem-budget <MB>] [--layout leaf|dfs] [--sync-launch] [--resident] [--cpu-share <fraction>]\n", argv[0]);
         return 1;
     }
     std::string db_path = argv[1];
     int min_support = std::stoi(argv[2]);
     std::string output_file = argv[3];
+    std::string output_format = "text";
+    size_t mem_budget_mb = 0;
+    FPArrayLayout layout = FPArrayLayout::Leaf;
+    bool async_launch = true;
+    bool resident = false;
+    double cpu_share = 0;
+    for (int i = 4; i < argc; ++i) {
+        if (strcmp(argv[i], "--output-format") == 0 && i + 1 < argc) {
+            output_format = argv[++i];
+        } else if (strcmp(argv[i], "--mem-budget") == 0 && i + 1 < argc) {
+            mem_budget_mb = std::stoul(argv[++i]);
+        } else if (strcmp(argv[i], "--layout") == 0 && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (name == "leaf") {
+                layout = FPArrayLayout::Leaf;
+            } else if (name == "dfs") {
+                layout = FPArrayLayout::Dfs;
+            } else {
+                printf("Unknown layout: %s\n", name.c_str());
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--sync-launch") == 0) {
+            async_launch = false;
+        } else if (strcmp(argv[i], "--resident") == 0) {
+            resident = true;
+        } else if (strcmp(argv[i], "--cpu-share") == 0 && i + 1 < argc) {
+            cpu_share = std::stod(argv[++i]);
+        } else {
+            printf("Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (output_format != "text" && output_format != "trie") {
+        printf("Unknown output format: %s\n", output_format.c_str());
+        return 1;
+    }
 
     std::filesystem::path exe_path = std::filesystem::canonical(argv[0]);
     std::filesystem::path upmem_dir = exe_path.parent_path().parent_path(); // Go up from build/ to upmem/
     std::string dpu_db_count_path = (upmem_dir / "build" / "db_count_item").string();
+    std::string dpu_db_filter_path = (upmem_dir / "build" / "db_filter_item").string();
     std::string dpu_mine_candidates_path = (upmem_dir / "build" / "mine_candidates").string();
     
     setenv("DPU_DB_COUNT_ITEM_PATH", dpu_db_count_path.c_str(), 1);
+    setenv("DPU_DB_FILTER_ITEM_PATH", dpu_db_filter_path.c_str(), 1);
     setenv("DPU_MINE_CANDIDATES_PATH", dpu_mine_candidates_path.c_str(), 1);
     
     Database db(db_path.c_str()); 
 
     FPTree fp_tree(min_support, &db);
+    fp_tree.set_mem_budget(mem_budget_mb << 20);
+    fp_tree.set_layout(layout);
+    fp_tree.set_async_launch(async_launch);
+    fp_tree.set_resident(resident);
+    fp_tree.set_cpu_share(cpu_share);
 
     //Timer::instance().start("Build FP-Tree");
     fp_tree.build_tree();
@@ -41,38 +87,54 @@ int main(int argc, char* argv[]) {
     fp_tree.build_k1_ele_pos();
     Timer::instance().stop();
     
-    fp_tree.mine_frequent_itemsets();
+    try {
+        fp_tree.mine_frequent_itemsets();
+    } catch (const std::exception&) {
+        // Already reported, a partial result is not written
+        DpuResources::instance().release();
+        return 1;
+    }
+    DpuResources::instance().release();
 
     // std::vector<std::vector<int>> frequent_itemsets;
     // std::vector<int> prefix_path;
     // fp_tree.mine_pattern(prefix_path, frequent_itemsets);
 
-    // make output file
-    std::ofstream output(output_file);
+    Timer::instance().start("Write Output");
+    if (output_format == "trie") {
+        // (prefix itemset id, suffix item) pairs are already a trie, write them without expanding
+        write_itemset_trie(output_file, NR_DB_ITEMS,
+                           fp_tree.get_frequent_itemsets_1(), fp_tree.get_frequent_supports_1(),
+                           fp_tree.get_frequent_itemsets_gt1(), fp_tree.get_frequent_supports_gt1());
+    } else {
+        // make output file
+        std::ofstream output(output_file);
 
-    std::function<void(uint32_t)> get_prefix = [&output, &fp_tree, &get_prefix](uint32_t item) {
-        if (item < NR_DB_ITEMS) {
-            output << item << " ";
-        } else {
-            const auto& prefix = fp_tree.get_frequent_itemsets_gt1()[item - NR_DB_ITEMS];
-            get_prefix(prefix.first);
-            if (prefix.second != (uint32_t)-1)
-                output << prefix.second << " ";
-        }
-    };
+        std::function<void(uint32_t)> get_prefix = [&output, &fp_tree, &get_prefix](uint32_t item) {
+            if (item < NR_DB_ITEMS) {
+                output << item << " ";
+            } else {
+                const auto& prefix = fp_tree.get_frequent_itemsets_gt1()[item - NR_DB_ITEMS];
+                get_prefix(prefix.first);
+                if (prefix.second != (uint32_t)-1)
+                    output << prefix.second << " ";
+            }
+        };
 
-    for (const auto& itemset : fp_tree.get_frequent_itemsets()) {
-        auto [first, second] = itemset;
-        if (first < NR_DB_ITEMS) {
-            output << first;
-            if (second != (uint32_t)-1)
-                output << " " << second;
-            output << std::endl;
-        } else {
-            get_prefix(first);
-            output << second << std::endl;
+        for (const auto& itemset : fp_tree.get_frequent_itemsets()) {
+            auto [first, second] = itemset;
+            if (first < NR_DB_ITEMS) {
+                output << first;
+                if (second != (uint32_t)-1)
+                    output << " " << second;
+                output << '\n';
+            } else {
+                get_prefix(first);
+                output << second << '\n';
+            }
         }
     }
+    Timer::instance().stop();
 
     Timer::instance().print_records();
 
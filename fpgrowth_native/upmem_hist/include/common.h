@@ -8,6 +8,15 @@ struct FPArrayEntry {
     uint32_t depth;
 };
 
+// FP-array entry as stored in MRAM. The kernel only needs the item, the parent and the depth:
+// items are DB items below NR_DB_ITEMS and a depth never exceeds the number of frequent items,
+// so both fit in 16 bits and an entry takes 8 bytes.
+struct PackedFPArrayEntry {
+    int32_t parent_pos;
+    uint16_t item;
+    uint16_t depth;
+};
+
 struct ElePosEntry {
     uint32_t item;
     uint32_t pos;
@@ -22,4 +31,31 @@ struct CandidateEntry {
     uint32_t support;
 };
 
+// Ends a transaction in the DPU transaction buffers and pads it to a multiple of 8 bytes,
+// so every transaction starts 8-byte aligned
+#define TRX_END (-1)
+
+// Two-phase candidate mining, selected through the mine_phase host variable
+#define MINE_PHASE_COUNT (0)    // Aggregate the support of every (prefix, suffix) key
+#define MINE_PHASE_COLLECT (1)  // Emit only the candidates whose key is in the frequent key set
+#define MINE_PHASE_RESIDENT (2) // Write the next-level ElePos of the frequent keys to the other ElePos slot
+
+// Key 0 is never a candidate, the prefix of a candidate is never the root item
+#define DPU_EMPTY_KEY (0ull)
+
+struct KeySupportEntry {
+    uint64_t key;
+    uint32_t support;
+    uint32_t reserved;
+};
+
+static inline uint64_t dpu_make_key(uint32_t prefix_item, uint32_t suffix_item) {
+    return ((uint64_t)prefix_item << 32) | suffix_item;
+}
+
+// Home slot of a key in the MRAM tables, shared by host and DPU
+static inline uint32_t dpu_key_hash(uint64_t key) {
+    return (uint32_t)(key >> 32) * 0x9E3779B1u + (uint32_t)key;
+}
+
 #endif // COMMON_H
\ No newline at end of file
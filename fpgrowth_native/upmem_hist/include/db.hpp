@@ -33,8 +33,11 @@ private:
     std::ifstream _file;
     int _min_support;
     std::vector<int> _item_count;
+    std::vector<int> _rank_item;            // Frequent items by descending support
+    std::vector<uint32_t> _trx_sizes;       // Elements of the last transaction buffer of every DPU
+    int _nr_count_rounds = 0;
     void dpu_count_items(dpu::DpuSet& system, std::vector<std::vector<int32_t>>& buffers);
-    std::vector<int> dpu_filter_items(dpu::DpuSet& system, std::vector<int>& item_count);
+    std::vector<std::vector<int>> dpu_filter_items(dpu::DpuSet& system);
 };
 
 #endif
\ No newline at end of file
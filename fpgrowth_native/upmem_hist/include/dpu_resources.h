@@ -0,0 +1,31 @@
+#ifndef DPU_RESOURCES_H
+#define DPU_RESOURCES_H
+
+#include <memory>
+#include <string>
+#include <dpu>
+
+// Process-wide DPU allocation. The DPUs are allocated on first use and every phase switches
+// programs on the same set, a program is only loaded when it differs from the loaded one.
+class DpuResources {
+public:
+    static DpuResources& instance() {
+        static DpuResources resources_instance;
+        return resources_instance;
+    }
+
+    // The DPU set with program loaded, no timer may be running
+    dpu::DpuSet& acquire(const std::string& program);
+    // Free the DPUs, the next acquire() allocates again
+    void release();
+
+private:
+    DpuResources() = default;
+    DpuResources(const DpuResources&) = delete;
+    DpuResources& operator=(const DpuResources&) = delete;
+
+    std::unique_ptr<dpu::DpuSet> _system;
+    std::string _program;
+};
+
+#endif // DPU_RESOURCES_H
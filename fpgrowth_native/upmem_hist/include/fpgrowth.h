@@ -2,10 +2,15 @@
 #define FPGROWTH_H
 
 #include <vector>
+#include <functional>
+#include <algorithm>
 #include <list>
 
 #include "db.hpp"
 #include "common.h"
+#include "candidate_table.h"
+#include "dpu_transfer.h"
+#include "mram_layout.h"
 #include "param.h"
 
 struct Node {
@@ -29,37 +34,26 @@ struct HeaderTableEntry {
     std::list<Node*> node_link;
 };
 
-struct TempCandidates {
-private:
-    uint32_t support;
-    uint32_t prefix_item;
-    uint32_t suffix_item;
-
-public:
-    std::vector<CandidateEntry> candidates;
-
-    TempCandidates() : support(0), prefix_item(0), suffix_item(0) {}
 
-    TempCandidates(CandidateEntry first): support(first.support), prefix_item(first.prefix_item), suffix_item(first.suffix_item) {
-        candidates.push_back(first);
-    }
-
-    void add_candidate(const CandidateEntry& candidate) {
-        candidates.push_back(candidate);
-        support += candidate.support;
-    }
-
-    uint32_t get_support() const {
-        return support;
-    }
+// Order of the FP-array entries, see --layout
+enum class FPArrayLayout {
+    Leaf, // Each leaf, then its ancestors up to the first already placed node
+    Dfs   // Preorder from the root, ancestors sit close before their descendants
+};
 
-    uint32_t get_prefix_item() const {
-        return prefix_item;
-    }
+// Candidates of the host share of a batch, see set_cpu_share()
+struct CpuWalk {
+    CandidateTable supports;
+    std::vector<CandidateEntry> candidates;
+    double seconds = 0;
+};
 
-    uint32_t get_suffix_item() const {
-        return suffix_item;
-    }
+// ElePos of one partition, ready to be copied to the DPUs
+struct PartitionUpload {
+    std::vector<std::vector<std::vector<ElePosEntry>>> distributed; // [rank][DPU], padded to the longest range of the rank
+    std::vector<std::vector<uint32_t>> counts;                      // Real entries per DPU
+    uint64_t max_candidates = 0;                                    // Largest candidate count of a DPU
+    size_t end = 0;                                                 // ElePos consumed up to here
 };
 
 class FPTree {
@@ -69,13 +63,41 @@ public:
 
     void build_tree();
     void build_fp_array();
+    void build_fp_array_dfs();
     void build_k1_ele_pos();
-    void dpu_mine_candidates(dpu::DpuSet& system, const std::vector<ElePosEntry>& ele_pos, 
-                             std::unordered_map<uint64_t, TempCandidates>& candidate_map);
-    std::unordered_map<uint64_t, TempCandidates> mine_candidates(dpu::DpuSet& system, const std::vector<ElePosEntry>& ele_pos);
+    std::vector<std::vector<PackedFPArrayEntry>> shard_fp_array(const std::vector<uint32_t>& rank_sizes);
+    const std::vector<uint32_t>* dpu_positions(uint32_t dpu) const;
+    size_t route_to_shards(const std::vector<ElePosEntry>& ele_pos, size_t begin, size_t end, uint64_t max_dpu_candidates,
+                           std::vector<std::vector<ElePosEntry>>& distributed) const;
+    PartitionUpload prepare_partition(const std::vector<ElePosEntry>& ele_pos, size_t begin,
+                                      const std::vector<uint32_t>& rank_sizes, uint64_t max_dpu_candidates);
+    void run_partitions(dpu::DpuSet& system, const std::vector<ElePosEntry>& ele_pos, uint64_t max_dpu_candidates,
+                        const std::function<void(const PartitionUpload&)>& configure,
+                        const std::function<void(const PartitionUpload&, int)>& read_back,
+                        const std::function<void(int)>& merge);
+    uint64_t broadcast_key_set(dpu::DpuSet& system, const CandidateTable& candidates);
+    size_t split_for_cpu(const std::vector<ElePosEntry>& ele_pos, uint64_t& cpu_weight, uint64_t& dpu_weight) const;
+    void cpu_count_keys(const std::vector<ElePosEntry>& ele_pos, size_t begin, size_t end, CpuWalk& walk) const;
+    void cpu_collect_candidates(const std::vector<ElePosEntry>& ele_pos, size_t begin, size_t end,
+                                const CandidateTable& candidates, CpuWalk& walk) const;
+    void mine_candidates(dpu::DpuSet& system, const std::vector<ElePosEntry>& all_ele_pos, CandidateTable& candidates);
+    std::vector<ElePosEntry> pull_resident_ele_pos(dpu::DpuSet& system, uint32_t slot, const std::vector<uint32_t>& counts);
+    void mine_resident(dpu::DpuSet& system, std::vector<ElePosEntry>& ele_pos);
+    uint64_t candidate_weight(const std::vector<ElePosEntry>& ele_pos) const;
+    bool split_batch(std::vector<ElePosEntry>& batch, std::vector<ElePosEntry>& rest) const;
     void mine_frequent_itemsets();
     void delete_tree();
 
+    // Bytes a batch of ElePos may hold while it is mined, 0 mines whole levels breadth-first
+    void set_mem_budget(size_t bytes) { _mem_budget = bytes; }
+    void set_layout(FPArrayLayout layout) { _layout = layout; }
+    // Overlap host pre/postprocessing of a partition with DPU execution of the next one
+    void set_async_launch(bool async_launch) { _async_launch = async_launch; }
+    // Keep the ElePos of the next levels in MRAM while they fit, see mine_resident()
+    void set_resident(bool resident) { _resident = resident; }
+    // Initial fraction of every batch walked by host threads, adapted to the measured rates. 0 disables it.
+    void set_cpu_share(double share) { _cpu_share = share; }
+
     std::vector<std::pair<uint32_t, uint32_t>> get_frequent_itemsets() {
         std::vector<std::pair<uint32_t, uint32_t>> frequent_itemsets(_frequent_itemsets_1.begin(), _frequent_itemsets_1.end());
         frequent_itemsets.insert(frequent_itemsets.end(), _frequent_itemsets_gt1.begin(), _frequent_itemsets_gt1.end());
@@ -83,10 +105,22 @@ public:
         return frequent_itemsets;
     }
 
+    const std::vector<std::pair<uint32_t, uint32_t>>& get_frequent_itemsets_1() const {
+        return _frequent_itemsets_1;
+    }
+
     const std::vector<std::pair<uint32_t, uint32_t>>& get_frequent_itemsets_gt1() const {
         return _frequent_itemsets_gt1;
     }
 
+    const std::vector<uint32_t>& get_frequent_supports_1() const {
+        return _frequent_supports_1;
+    }
+
+    const std::vector<uint32_t>& get_frequent_supports_gt1() const {
+        return _frequent_supports_gt1;
+    }
+
 private:
     Node* _root; // Root item number is 0
     uint32_t _node_cnt;
@@ -97,7 +131,21 @@ private:
     std::vector<ElePosEntry> _k1_ele_pos;
     std::vector<std::pair<uint32_t, uint32_t>> _frequent_itemsets_1;
     std::vector<std::pair<uint32_t, uint32_t>> _frequent_itemsets_gt1;
+    std::vector<uint32_t> _frequent_supports_1;
+    std::vector<uint32_t> _frequent_supports_gt1;
     uint32_t _itemset_id = NR_DB_ITEMS;
+    size_t _mem_budget = 0;
+    FPArrayLayout _layout = FPArrayLayout::Leaf;
+    bool _async_launch = true;
+    bool _resident = false;
+    double _cpu_share = 0;
+    uint32_t _key_set_bits = MIN_TABLE_BITS; // Size of the frequent key set broadcast for phase 2
+    MramLayout _mram;                        // Regions of the mining kernel, planned with the FP-array
+    // Subtree shards of an FP-array too large for one DPU, all empty when every DPU holds the whole array
+    std::vector<uint32_t> _shard_of;                       // Shard of every FP-array position
+    std::vector<uint32_t> _local_pos;                      // Position of every FP-array entry in its shard
+    std::vector<std::vector<uint32_t>> _shard_positions;   // FP-array position of every shard entry
+    std::vector<uint32_t> _shard_first_dpu;                // DPUs of shard s are [_shard_first_dpu[s], _shard_first_dpu[s + 1])
 
     void delete_tree(Node* node);
 };
@@ -0,0 +1,55 @@
+#ifndef MRAM_LAYOUT_H
+#define MRAM_LAYOUT_H
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+#include "common.h"
+#include "param.h"
+
+// MRAM regions of mine_candidates, planned per run once the FP-array is known and passed to the
+// kernel through its __host variables:
+//   [0, elepos_offset)                              packed FP-array
+//   [elepos_offset, candidate_offset)               ElePos, two slots of elepos_slot_size when resident
+//   [candidate_offset, candidate_offset + candidate_size)  phase tables, key sets and candidates
+struct MramLayout {
+    uint32_t elepos_offset = 0;
+    uint32_t elepos_slot_size = 0;
+    uint32_t candidate_offset = 0;
+    uint32_t candidate_size = 0;
+
+    uint64_t elepos_entries() const { return 2ull * elepos_slot_size / sizeof(ElePosEntry); }
+    uint64_t slot_entries() const { return elepos_slot_size / sizeof(ElePosEntry); }
+    // Phase 1 needs a table of up to 4x the candidates of a DPU plus a compacted copy of half of it
+    uint64_t max_dpu_candidates() const { return candidate_size / (6 * sizeof(KeySupportEntry)); }
+};
+
+// Largest FP-array a DPU can hold next to the smallest ElePos and candidate regions
+inline uint64_t mram_fp_array_capacity() {
+    return MRAM_TRX_ARRAY_SZ - MRAM_MIN_ELEPOS_SZ - MRAM_MIN_CANDIDATE_SZ;
+}
+
+// Everything the FP-array leaves is split between ElePos and candidates in the ratio a DPU fills
+// them, an ElePos entry walks weight / nr_ele_pos candidates on average.
+// Throws when the FP-array leaves less than the minimum of both regions.
+inline MramLayout plan_mram_layout(uint64_t fp_array_bytes, uint64_t weight, uint64_t nr_ele_pos) {
+    uint64_t fp_end = ALIGN_UP(fp_array_bytes, 8);
+    if (fp_end > mram_fp_array_capacity()) {
+        throw std::length_error("FP-Array does not fit in the MRAM of one DPU");
+    }
+    uint64_t free = MRAM_TRX_ARRAY_SZ - fp_end;
+
+    double walked = nr_ele_pos > 0 ? static_cast<double>(weight) / nr_ele_pos : 1;
+    double share = sizeof(ElePosEntry) / (sizeof(ElePosEntry) + walked * 6 * sizeof(KeySupportEntry));
+    uint64_t elepos = std::clamp<uint64_t>(free * share, MRAM_MIN_ELEPOS_SZ, free - MRAM_MIN_CANDIDATE_SZ);
+
+    MramLayout layout;
+    layout.elepos_offset = fp_end;
+    layout.elepos_slot_size = ALIGN_DOWN(elepos / 2, sizeof(ElePosEntry));
+    layout.candidate_offset = layout.elepos_offset + 2 * layout.elepos_slot_size;
+    layout.candidate_size = ALIGN_DOWN(MRAM_TRX_ARRAY_SZ - layout.candidate_offset, 8);
+    return layout;
+}
+
+#endif // MRAM_LAYOUT_H
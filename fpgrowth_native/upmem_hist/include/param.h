@@ -13,6 +13,9 @@
 #ifndef DPU_DB_COUNT_ITEM
 #define DPU_DB_COUNT_ITEM (getenv("DPU_DB_COUNT_ITEM_PATH") ? getenv("DPU_DB_COUNT_ITEM_PATH") : "db_count_item")
 #endif
+#ifndef DPU_DB_FILTER_ITEM
+#define DPU_DB_FILTER_ITEM (getenv("DPU_DB_FILTER_ITEM_PATH") ? getenv("DPU_DB_FILTER_ITEM_PATH") : "db_filter_item")
+#endif
 #ifndef DPU_MINE_CANDIDATES
 #define DPU_MINE_CANDIDATES (getenv("DPU_MINE_CANDIDATES_PATH") ? getenv("DPU_MINE_CANDIDATES_PATH") : "mine_candidates")
 #endif
@@ -20,18 +23,30 @@
 #define BLOCK_SIZE (1024)
 #define MRAM_MAX (64ull << 20)
 #define MRAM_TRX_ARRAY_RESERVED (1ull << 20)
-#define MRAM_FP_ARRAY_SZ (16ull << 20)
-#define MRAM_FP_ELEPOS_SZ (4ull << 20)
+// Smallest regions plan_mram_layout() leaves next to the FP-array, see mram_layout.h
+#define MRAM_MIN_ELEPOS_SZ (512ull << 10)
+#define MRAM_MIN_CANDIDATE_SZ (4ull << 20)
 
 #define ALIGN_DOWN(BYTES, ALIGN) ((BYTES) - ((BYTES) % (ALIGN)))
+#define ALIGN_UP(BYTES, ALIGN) ALIGN_DOWN((BYTES) + (ALIGN) - 1, ALIGN)
 #define MRAM_TRX_ARRAY_SZ ALIGN_DOWN(MRAM_MAX - MRAM_TRX_ARRAY_RESERVED, 8)
+#define MIN_TABLE_BITS (10)
 
 #ifndef NR_DB_ITEMS
 #define NR_DB_ITEMS (1024) // Should be a power of 2
 #endif
+// Items stay below NR_DB_ITEMS, but a path through every item is NR_DB_ITEMS deep
+#if NR_DB_ITEMS >= (1 << 16)
+#error "PackedFPArrayEntry holds items and depths in 16 bits"
+#endif
 
-#define DPU_CONFIG "backend=hw"
+#ifndef DPU_CONFIG
+#define DPU_CONFIG "backend=hw" // make BACKEND=simulator to run on the functional simulator
+#endif
 
-#define NR_THREADS 4
+#define NR_THREADS 4 // Loader threads, also the host walkers when the core count is unknown
+#define HYBRID_MIN_CPU_SHARE (0.01) // Keeps measuring the host rate, see --cpu-share
+#define HYBRID_MAX_CPU_SHARE (0.9)
+#define CANDIDATE_FOOTPRINT (64) // Host bytes held per walked candidate while a batch is mined, see --mem-budget
 
 #endif
\ No newline at end of file
@@ -51,6 +51,13 @@ public:
         return static_cast<int64_t>(duration);
     }
 
+    // Drop the running measurement of a stage aborted by an exception
+    void discard() {
+        running = false;
+        current_name.reset();
+        start_time.reset();
+    }
+
     const std::unordered_map<std::string, Record>& get_records() const {
         return records;
     }
@@ -7,7 +7,6 @@
 #include "./histogram/histogram_long.h"
 #endif
 
-#define MAX_BUF_ELEM    (MRAM_AVAILABLE >> 2)   // MRAM_AVAILABLE / sizeof(int32_t)
 #define CACHE_ELEM      (BLOCK_SIZE >> 2)       // BLOCK_SIZE / sizeof(int32_t)
 
 __host uint32_t count; // TODO: Consider copy this value before use (tasklet-safe?)
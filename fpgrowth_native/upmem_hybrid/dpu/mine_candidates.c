@@ -12,6 +12,9 @@
 #include "common.h"
 
 __host uint32_t k_elepos_size;
+// MRAM layout planned by the host, the FP-array starts at 0
+__host uint32_t elepos_offset;
+__host uint32_t candidate_offset;
 
 //---------------------------------------
 // FP Growth structures
@@ -138,11 +141,11 @@ static inline void get_fp_array_item(uint32_t idx, fp_array_entry_t* item) {
 }
 
 static inline void get_k_elepos_item(uint32_t idx, elepos_entry_t* item) {
-    mram_read((__mram_ptr void const*) (DPU_MRAM_HEAP_POINTER + MRAM_FP_ARRAY_SZ + idx * sizeof(elepos_entry_t)), item, sizeof(elepos_entry_t));
+    mram_read((__mram_ptr void const*) (DPU_MRAM_HEAP_POINTER + elepos_offset + idx * sizeof(elepos_entry_t)), item, sizeof(elepos_entry_t));
 }
 
 static inline void set_candidate_item(uint32_t idx, const candidate_entry_t* item) {
-    mram_write(item, (__mram_ptr void*) (DPU_MRAM_HEAP_POINTER + MRAM_FP_ARRAY_SZ + MRAM_FP_ELEPOS_SZ + idx * sizeof(candidate_entry_t)), sizeof(candidate_entry_t));
+    mram_write(item, (__mram_ptr void*) (DPU_MRAM_HEAP_POINTER + candidate_offset + idx * sizeof(candidate_entry_t)), sizeof(candidate_entry_t));
 }
 
 int main() {
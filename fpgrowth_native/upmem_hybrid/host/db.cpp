@@ -5,6 +5,8 @@
 #include <cstdint>
 #include <thread>
 
+#include "dpu_resources.h"
+#include "dpu_transfer.h"
 #include "param.h"
 #include "timer.h"
 
@@ -72,42 +74,54 @@ void Database::seek_to_start() {
     _file.seekg(0, std::ios::beg);
 }
 
-void Database::dpu_count_items(dpu::DpuSet& system, std::vector<std::vector<int32_t>>& buffers) {
-    uint32_t nr_of_dpus = system.dpus().size();
-    std::vector<std::vector<uint32_t>> counts(nr_of_dpus, std::vector<uint32_t>(1, 0));
-    std::vector<std::vector<uint32_t>> results(nr_of_dpus, std::vector<uint32_t>(NR_DB_ITEMS, 0));
-    
-    for (uint32_t i = 0; i < nr_of_dpus; i++) {
-        counts[i][0] = buffers[i].size();
-        if (i == 0) {
-            if (counts[0][0] % 2 == 1) {
-                buffers[0].push_back(0); // Ensure even number of elements for DPU processing
-            }
-        } else {
-            int padding = buffers[0].size() - buffers[i].size();
-            if (padding > 0) {
-                buffers[i].resize(buffers[i].size() + padding, 0); // Pad with zeros
-            } 
+void Database::dpu_count_items(std::vector<dpu::DpuSet*>& groups, std::vector<std::vector<std::vector<int32_t>>>& buffers) {
+    std::vector<std::vector<std::vector<uint32_t>>> counts(groups.size());
+    std::vector<std::vector<std::vector<uint32_t>>> results(groups.size());
+    std::vector<std::vector<std::vector<std::vector<int32_t>>>> by_rank(groups.size()); // [group][rank][DPU]
+    for (size_t g = 0; g < groups.size(); g++) {
+        for (const std::vector<int32_t>& buffer : buffers[g]) {
+            counts[g].push_back(std::vector<uint32_t>(1, buffer.size()));
         }
+        results[g].assign(buffers[g].size(), std::vector<uint32_t>(NR_DB_ITEMS, 0));
+        // Padded to the longest buffer of each rank only, transfers are rounded up to 8 bytes
+        by_rank[g] = group_by_rank(dpus_per_rank(*groups[g]), std::move(buffers[g]), 0);
     }
 
+    // Groups are separate DPU sets, their async queues keep the transfers of all ranks in parallel
     Timer::instance().start("Count Items - Transfer(To DPU)");
-    system.copy(DPU_MRAM_HEAP_POINTER_NAME, buffers);
-    system.copy("count", counts);
+    for (size_t g = 0; g < groups.size(); g++) {
+        push_ragged(*groups[g], DPU_MRAM_HEAP_POINTER_NAME, 0, by_rank[g]);
+        groups[g]->async().copy("count", counts[g]);
+    }
+    for (dpu::DpuSet* group : groups) {
+        group->async().sync();
+    }
     Timer::instance().stop();
 
     Timer::instance().start("Count Items - Exec");
-    system.exec();
+    for (dpu::DpuSet* group : groups) {
+        group->async().exec();
+    }
+    for (dpu::DpuSet* group : groups) {
+        group->async().sync();
+    }
     Timer::instance().stop();
 
     Timer::instance().start("Count Items - Transfer Histogram(To CPU)");
-    system.copy(results, DPU_MRAM_HEAP_POINTER_NAME, MRAM_TRX_ARRAY_SZ);
+    for (size_t g = 0; g < groups.size(); g++) {
+        groups[g]->async().copy(results[g], DPU_MRAM_HEAP_POINTER_NAME, MRAM_TRX_ARRAY_SZ);
+    }
+    for (dpu::DpuSet* group : groups) {
+        group->async().sync();
+    }
     Timer::instance().stop();
 
     // Reduce results
-    for (uint32_t d = 0; d < nr_of_dpus; d++) {
-        for (uint32_t i = 0; i < NR_DB_ITEMS; i++) {
-            _item_count[i] += results[d][i];
+    for (const auto& group_results : results) {
+        for (const std::vector<uint32_t>& result : group_results) {
+            for (uint32_t i = 0; i < NR_DB_ITEMS; i++) {
+                _item_count[i] += result[i];
+            }
         }
     }
 }
@@ -121,37 +135,43 @@ std::vector<std::pair<int, int>> Database::scan_for_frequent_items(int min_suppo
     seek_to_start();
     
     try {
-        Timer::instance().start("Count Items - DPU Init");
-        auto system = dpu::DpuSet::allocate(NR_DPUS, DPU_CONFIG);
-        system.load(DPU_DB_COUNT_ITEM);
-        Timer::instance().stop();
-        
-        uint32_t nr_of_dpus = system.dpus().size();
-        std::vector<std::vector<int32_t>> buffers(nr_of_dpus, std::vector<int32_t>());
+        // The count phase runs on the DPU sets of the mining groups, they stay allocated for mining
+        std::vector<dpu::DpuSet*>& groups = DpuResources::instance().acquire(DPU_DB_COUNT_ITEM);
+        std::vector<std::vector<std::vector<int32_t>>> buffers; // [group][DPU]
+        for (dpu::DpuSet* group : groups) {
+            buffers.emplace_back(group->dpus().size());
+        }
 
-        int buffer_idx = 0;
+        size_t group_idx = 0;
+        size_t buffer_idx = 0;
         std::string line;
         Timer::instance().start("Count Items - Prepare");
         while (std::getline(_file, line)) {
             std::istringstream iss(line);
             int item;
             while (iss >> item) {
-                if (buffers[buffer_idx].size() >= MAX_ELEMS) {
+                if (buffers[group_idx][buffer_idx].size() >= MAX_ELEMS) {
                     Timer::instance().stop();
-                    dpu_count_items(system, buffers);
+                    dpu_count_items(groups, buffers);
                     Timer::instance().start("Count Items - Prepare");
+                    group_idx = 0;
                     buffer_idx = 0;
-                    for (uint32_t i = 0; i < nr_of_dpus; i++) {
-                        buffers[i].clear();
+                    for (auto& group_buffers : buffers) {
+                        for (std::vector<int32_t>& buffer : group_buffers) {
+                            buffer.clear();
+                        }
                     }
                 }
-                buffers[buffer_idx].push_back(item);
-                buffer_idx = (buffer_idx + 1) % nr_of_dpus;
+                buffers[group_idx][buffer_idx].push_back(item);
+                if (++buffer_idx == buffers[group_idx].size()) {
+                    buffer_idx = 0;
+                    group_idx = (group_idx + 1) % buffers.size();
+                }
             }
         }
         Timer::instance().stop();
-        if (buffers[0].size() > 0) {
-            dpu_count_items(system, buffers);
+        if (buffers[0][0].size() > 0) {
+            dpu_count_items(groups, buffers);
         }
 
         for (int i = 0; i < NR_DB_ITEMS; i++) {
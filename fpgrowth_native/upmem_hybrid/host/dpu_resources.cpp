@@ -0,0 +1,36 @@
+#include "dpu_resources.h"
+
+#include <iostream>
+
+#include "param.h"
+#include "timer.h"
+
+std::vector<dpu::DpuSet*>& DpuResources::acquire(const std::string& program) {
+    if (_systems.empty()) {
+        Timer::instance().start("DPU Init - Allocate");
+        for (int group_id = 0; group_id < NR_GROUPS; ++group_id) {
+            _systems.emplace_back(new dpu::DpuSet(dpu::DpuSet::allocate(NR_DPUS / NR_GROUPS, DPU_CONFIG)));
+            _groups.push_back(_systems.back().get());
+        }
+        Timer::instance().stop();
+        std::cout << "Allocated " << NR_GROUPS << " groups of " << _groups[0]->dpus().size() << " DPUs ("
+                  << DPU_CONFIG << ")" << std::endl;
+        _program.clear();
+    }
+
+    if (program != _program) {
+        Timer::instance().start("DPU Init - Load");
+        for (dpu::DpuSet* group : _groups) {
+            group->load(program);
+        }
+        Timer::instance().stop();
+        _program = program;
+    }
+    return _groups;
+}
+
+void DpuResources::release() {
+    _groups.clear();
+    _systems.clear();
+    _program.clear();
+}
@@ -8,6 +8,8 @@
 #include <thread>
 #include <barrier>
 
+#include "dpu_resources.h"
+#include "dpu_transfer.h"
 #include "param.h"
 #include "timer.h"
 
@@ -205,24 +207,67 @@ void FPTree::build_k1_ele_pos() {
     // std::cout << std::endl;
 }
 
-void FPTree::dpu_mine_candidates(dpu::DpuSet& system, const std::vector<ElePosEntry>& ele_pos, int group_id) {
+// Candidates the DPUs write for ele_pos, every entry walks depth - 1 ancestors
+static uint64_t candidate_weight(const std::vector<ElePosEntry>& ele_pos, const std::vector<FPArrayEntry>& fp_array) {
+    uint64_t weight = 0;
+    for (const ElePosEntry& entry : ele_pos) {
+        if (entry.item != 0) weight += fp_array[entry.pos].depth - 1;
+    }
+    return weight;
+}
+
+// Split ele_pos into at most nr_parts ranges of similar candidate count, the work of an
+// entry is its depth - 1. A range holds at most max_entries entries and max_weight candidates,
+// so the returned range ends may stop short of ele_pos.size().
+static std::vector<size_t> split_by_depth(const std::vector<ElePosEntry>& ele_pos, const std::vector<FPArrayEntry>& fp_array,
+                                          size_t nr_parts, size_t max_entries, uint64_t max_weight) {
+    uint64_t remaining = candidate_weight(ele_pos, fp_array);
+
+    std::vector<size_t> ends;
+    size_t end = 0;
+    for (size_t part = 0; part < nr_parts && end < ele_pos.size(); ++part) {
+        // Rebalance against what is left, earlier ranges may have been capped by max_entries
+        uint64_t target = (remaining + (nr_parts - part) - 1) / (nr_parts - part);
+        uint64_t weight = 0;
+        size_t begin = end;
+        // A single entry always fits, its depth stays below NR_DB_ITEMS and MRAM_MIN_CANDIDATE_SZ holds far more
+        while (end < ele_pos.size() && end - begin < max_entries && (weight < target || end == begin)) {
+            const ElePosEntry& entry = ele_pos[end];
+            uint64_t entry_weight = entry.item != 0 ? fp_array[entry.pos].depth - 1 : 0;
+            if (end > begin && weight + entry_weight > max_weight) break;
+            weight += entry_weight;
+            end++;
+        }
+        remaining -= weight;
+        ends.push_back(end);
+    }
+    return ends;
+}
+
+// Depth-balanced ElePos ranges of every DPU of a group for ele_pos[begin, ...), padded to the longest one of their rank
+PartitionUpload FPTree::prepare_partition(dpu::DpuSet& system, const std::vector<ElePosEntry>& ele_pos, size_t begin, int group_id) {
     std::vector<FPArrayEntry>& fp_array = _local_fp_arrays[group_id];
 
     Timer::local_instance(group_id).start("Mine Freq Items - Preprocess");
+    PartitionUpload upload;
     int nr_of_dpus = system.dpus().size();
+    const MramLayout& mram = _mram[group_id];
+    size_t end = std::min<size_t>(ele_pos.size(), begin + mram.elepos_entries() * nr_of_dpus);
+    std::vector<ElePosEntry> range(ele_pos.begin() + begin, ele_pos.begin() + end);
 
     // Distribute ElePos across DPUs
-    std::cout << "ElePos size: " << ele_pos.size() * sizeof(ElePosEntry) / 1024.0 << " KB, distributing across " << nr_of_dpus << " DPUs, Group ID" << group_id << std::endl;
+    std::cout << "ElePos size: " << range.size() * sizeof(ElePosEntry) / 1024.0 << " KB, distributing across " << nr_of_dpus << " DPUs, Group ID" << group_id << std::endl;
+    // Depth-balanced ranges, so every DPU writes about the same number of candidates
+    std::vector<size_t> ends = split_by_depth(range, fp_array, nr_of_dpus, mram.elepos_entries(), mram.max_dpu_candidates());
     std::vector<std::vector<ElePosEntry>> distributed;
-    int quotent = ele_pos.size() / nr_of_dpus;
-    int remainder = ele_pos.size() % nr_of_dpus;
     
-    int max_candidates = 0;
-    std::vector<int> candidate_cnts(nr_of_dpus, 0);
+    upload.candidate_cnts.assign(nr_of_dpus, 0);
+    upload.counts.assign(nr_of_dpus, std::vector<uint32_t>(1, 0));
     for (int i = 0; i < nr_of_dpus; ++i) {
-        int start = i * quotent + std::min(i, remainder);
-        int end = start + quotent + (i < remainder ? 1 : 0);
-        distributed.push_back(std::vector<ElePosEntry>(ele_pos.begin() + start, ele_pos.begin() + end));
+        size_t start = i == 0 ? 0 : ends[std::min<size_t>(i, ends.size()) - 1];
+        size_t stop = i < (int)ends.size() ? ends[i] : start;
+        distributed.push_back(std::vector<ElePosEntry>(range.begin() + start, range.begin() + stop));
+        upload.counts[i][0] = distributed.back().size();
 
         // TODO: Consider this logic to be moved to the DPU code
         int candidate_start_idx = 0;
@@ -231,37 +276,20 @@ void FPTree::dpu_mine_candidates(dpu::DpuSet& system, const std::vector<ElePosEn
             if (distributed.back()[j].item == 0) continue;
             candidate_start_idx += fp_array[distributed.back()[j].pos].depth - 1;
         }
-        candidate_cnts[i] = candidate_start_idx;
-        max_candidates = std::max(max_candidates, candidate_start_idx);
-    }
-
-    std::vector<std::vector<uint32_t>> counts(nr_of_dpus, std::vector<uint32_t>(1, 0));
-    for (int i = 0; i < nr_of_dpus; ++i) {
-        counts[i][0] = distributed[i].size();
-        int padding = distributed[0].size() - distributed[i].size();
-        if (padding > 0) {
-            distributed[i].resize(distributed[i].size() + padding, {0, 0, 0, 0}); // Pad with zeros
-        }
+        upload.candidate_cnts[i] = candidate_start_idx;
     }
+    // Padded to the longest range of each rank only
+    upload.distributed = group_by_rank(dpus_per_rank(system), std::move(distributed), ElePosEntry {0, 0, 0, 0});
+    upload.end = begin + (ends.empty() ? 0 : ends.back());
     Timer::local_instance(group_id).stop();
 
-    Timer::local_instance(group_id).start("Mine Freq Items - Transfer kElePos(To DPU)");
-    system.copy("k_elepos_size", counts);
-    system.copy(DPU_MRAM_HEAP_POINTER_NAME, MRAM_FP_ARRAY_SZ, distributed);
-    Timer::local_instance(group_id).stop();
-
-    Timer::local_instance(group_id).start("Mine Freq Items - Exec");
-    system.exec();
-    Timer::local_instance(group_id).stop();
-
-    Timer::local_instance(group_id).start("Mine Freq Items - Transfer Candidates(To CPU)");
-    std::vector<std::vector<CandidateEntry>> candidates(nr_of_dpus, std::vector<CandidateEntry>(max_candidates));
-    system.copy(candidates, DPU_MRAM_HEAP_POINTER_NAME, MRAM_FP_ARRAY_SZ + MRAM_FP_ELEPOS_SZ);
-    Timer::local_instance(group_id).stop();
+    return upload;
+}
 
+void FPTree::merge_partition(const std::vector<std::vector<CandidateEntry>>& candidates, const std::vector<uint32_t>& candidate_cnts, int group_id) {
     Timer::local_instance(group_id).start("Mine Freq Items - Postprocess");
-    for (int i = 0; i < nr_of_dpus; ++i) {
-        for (int j = 0; j < candidate_cnts[i]; ++j) {
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        for (uint32_t j = 0; j < candidate_cnts[i]; ++j) {
             const CandidateEntry& candidate = candidates[i][j];
             if (candidate.suffix_item == 0) continue; // Skip root item
             uint64_t key = (static_cast<uint64_t>(candidate.prefix_item) << 32) | candidate.suffix_item;
@@ -271,39 +299,64 @@ void FPTree::dpu_mine_candidates(dpu::DpuSet& system, const std::vector<ElePosEn
     Timer::local_instance(group_id).stop();
 }
 
+// Partitions run back to back on the group: the next one is prepared while the DPUs execute and
+// the previous one is merged while the next one executes, the DPUs only wait for the read-back.
 void FPTree::mine_candidates(dpu::DpuSet& system, const std::vector<ElePosEntry>& ele_pos, int group_id) {
-    int nr_of_dpus = system.dpus().size();
-    
-    int max_elepos = (MRAM_FP_ELEPOS_SZ / sizeof(ElePosEntry)) * nr_of_dpus;
-    for (int partition = 0; partition < (int)ele_pos.size(); partition += max_elepos) {
-        int end = std::min(static_cast<int>(ele_pos.size()), partition + max_elepos);
-        std::vector<ElePosEntry> ele_pos_partition(ele_pos.begin() + partition, ele_pos.begin() + end);
+    auto launch = [&](const PartitionUpload& upload) {
+        Timer::local_instance(group_id).start("Mine Freq Items - Transfer kElePos(To DPU)");
+        system.async().copy("k_elepos_size", upload.counts);
+        push_ragged(system, DPU_MRAM_HEAP_POINTER_NAME, _mram[group_id].elepos_offset, upload.distributed);
+        system.async().exec();
+        Timer::local_instance(group_id).stop();
+    };
+
+    if (ele_pos.empty()) return;
+    PartitionUpload current = prepare_partition(system, ele_pos, 0, group_id);
+    launch(current);
+    while (true) {
+        // A partition may be only partly consumed when the depth split hits the per-DPU ElePos capacity
+        bool more = current.end < ele_pos.size();
+        PartitionUpload next;
+        if (more) {
+            next = prepare_partition(system, ele_pos, current.end, group_id);
+        }
+
+        Timer::local_instance(group_id).start("Mine Freq Items - Exec");
+        system.async().sync();
+        Timer::local_instance(group_id).stop();
+
+        // Every rank reads back only as many candidates as its busiest DPU wrote
+        Timer::local_instance(group_id).start("Mine Freq Items - Transfer Candidates(To CPU)");
+        std::vector<std::vector<CandidateEntry>> candidates = gather_ragged<CandidateEntry>(system, DPU_MRAM_HEAP_POINTER_NAME,
+                                                                                           _mram[group_id].candidate_offset, current.candidate_cnts);
+        Timer::local_instance(group_id).stop();
 
-        dpu_mine_candidates(system, ele_pos_partition, group_id);
+        if (more) {
+            launch(next);
+        }
+        merge_partition(candidates, current.candidate_cnts, group_id);
+
+        if (!more) break;
+        current = std::move(next);
     }
 }
 
 void FPTree::allocate_dpus() {
-    uint32_t dpus_per_group = NR_DPUS / NR_GROUPS;
-
-    _dpu_systems.clear();
-    _dpu_systems.resize(NR_GROUPS);
+    // The groups were allocated by the count phase, only the program changes
+    _dpu_systems = DpuResources::instance().acquire(DPU_MINE_CANDIDATES);
 
     _global_candidate_map.clear();
 
     _thread_running = true;
-
-    for (int group_id = 0; group_id < NR_GROUPS; ++group_id) {
-        _dpu_systems[group_id] = std::make_unique<DpuSetWrapper>(group_id, dpus_per_group);
-        _dpu_systems[group_id]->get().load(DPU_MINE_CANDIDATES);
-    }
 }
 
 template <class Completion>
 void FPTree::mine_freq_itemsets_worker(std::barrier<Completion>& sync, int group_id) {
-    dpu::DpuSet& system = _dpu_systems[group_id]->get();
+    dpu::DpuSet& system = *_dpu_systems[group_id];
     Timer::local_instance(group_id).start("Mine Freq Items - Transfer FP-Array(To DPU)");
     system.copy(DPU_MRAM_HEAP_POINTER_NAME, _local_fp_arrays[group_id]);
+    system.copy("elepos_offset", std::vector<uint32_t>(1, _mram[group_id].elepos_offset));
+    system.copy("candidate_offset", std::vector<uint32_t>(1, _mram[group_id].candidate_offset));
     Timer::local_instance(group_id).stop();
 
     while (true) {
@@ -323,14 +376,16 @@ void FPTree::merge_candidates() {
         elepos_list.clear();
     }
 
-    for (const auto& local_map : _global_candidate_map.get_maps()) {
-        for (const auto& [key, candidate_set] : local_map) {
+    for (auto& local_map : _global_candidate_map.get_maps()) {
+        for (auto& [key, candidate_set] : local_map) {
             if ((int)candidate_set.get_support() >= _min_support) {
                 uint32_t prefix_item = candidate_set.get_prefix_item();
                 _frequent_itemsets_gt1.push_back({prefix_item, candidate_set.get_suffix_item()});
                 
                 uint32_t itemset_id = _itemset_id++;
                 for (int i = 0; i < NR_GROUPS; ++i) {
+                    // Positions are local to a group, so only candidates of one group can merge
+                    coalesce_candidates(candidate_set.candidates[i]);
                     for (const auto& candidate : candidate_set.candidates[i]) {
                         _local_elepos_lists[i].emplace_back(ElePosEntry {
                             itemset_id,
@@ -392,6 +447,12 @@ void FPTree::merge_candidates() {
 }
 
 void FPTree::mine_frequent_itemsets() {
+    // Planned before the workers start, a local FP-array that does not fit is reported here
+    for (int group_id = 0; group_id < NR_GROUPS; ++group_id) {
+        const std::vector<FPArrayEntry>& fp_array = _local_fp_arrays[group_id];
+        const std::vector<ElePosEntry>& ele_pos = _local_elepos_lists[group_id];
+        _mram[group_id] = plan_mram_layout(fp_array.size() * sizeof(FPArrayEntry), candidate_weight(ele_pos, fp_array), ele_pos.size());
+    }
     allocate_dpus();
 
     std::barrier sync(NR_GROUPS, [this]() {
@@ -5,6 +5,7 @@
 #include <filesystem>
 #include <string>
 
+#include "dpu_resources.h"
 #include "timer.h"
 
 int main(int argc, char* argv[]) {
@@ -41,6 +42,7 @@ int main(int argc, char* argv[]) {
     Timer::instance().stop();
     
     fp_tree.mine_frequent_itemsets();
+    DpuResources::instance().release();
 
     // std::vector<std::vector<int>> frequent_itemsets;
     // std::vector<int> prefix_path;
@@ -33,7 +33,7 @@ private:
     std::ifstream _file;
     int _min_support;
     std::vector<int> _item_count;
-    void dpu_count_items(dpu::DpuSet& system, std::vector<std::vector<int32_t>>& buffers);
+    void dpu_count_items(std::vector<dpu::DpuSet*>& groups, std::vector<std::vector<std::vector<int32_t>>>& buffers);
     std::vector<int> dpu_filter_items(dpu::DpuSet& system, std::vector<int>& item_count);
 };
 
@@ -0,0 +1,34 @@
+#ifndef DPU_RESOURCES_H
+#define DPU_RESOURCES_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <dpu>
+
+// Process-wide DPU allocation, one DPU set per mining group. The groups are allocated on first
+// use and every phase switches programs on the same sets, a program is only loaded when it
+// differs from the loaded one.
+class DpuResources {
+public:
+    static DpuResources& instance() {
+        static DpuResources resources_instance;
+        return resources_instance;
+    }
+
+    // The DPU sets of all groups with program loaded, no timer may be running
+    std::vector<dpu::DpuSet*>& acquire(const std::string& program);
+    // Free the DPUs, the next acquire() allocates again
+    void release();
+
+private:
+    DpuResources() = default;
+    DpuResources(const DpuResources&) = delete;
+    DpuResources& operator=(const DpuResources&) = delete;
+
+    std::vector<std::unique_ptr<dpu::DpuSet>> _systems;
+    std::vector<dpu::DpuSet*> _groups;
+    std::string _program;
+};
+
+#endif // DPU_RESOURCES_H
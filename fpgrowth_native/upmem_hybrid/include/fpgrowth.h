@@ -2,6 +2,7 @@
 #define FPGROWTH_H
 
 #include <vector>
+#include <algorithm>
 #include <list>
 #include <unordered_map>
 #include <unordered_set>
@@ -12,6 +13,7 @@
 
 #include "db.hpp"
 #include "common.h"
+#include "mram_layout.h"
 #include "param.h"
 
 struct Node {
@@ -38,6 +40,23 @@ struct HeaderTableEntry {
     HeaderTableEntry(int item, int frequency): item(item), frequency(frequency) {}
 };
 
+// Merge candidates at the same FP-array position, they would walk the same ancestors at the next level
+static inline void coalesce_candidates(std::vector<CandidateEntry>& candidates) {
+    if (candidates.size() < 2) return;
+    std::sort(candidates.begin(), candidates.end(), [](const CandidateEntry& a, const CandidateEntry& b) {
+        return a.suffix_item_pos < b.suffix_item_pos;
+    });
+    size_t out = 0;
+    for (size_t i = 1; i < candidates.size(); ++i) {
+        if (candidates[i].suffix_item_pos == candidates[out].suffix_item_pos) {
+            candidates[out].support += candidates[i].support;
+        } else {
+            candidates[++out] = candidates[i];
+        }
+    }
+    candidates.resize(out + 1);
+}
+
 struct TempCandidates {
 private:
     uint32_t support;
@@ -71,28 +90,6 @@ public:
     }
 };
 
-class DpuSetWrapper {
-public:
-    explicit DpuSetWrapper(int group_id, uint32_t dpus_per_group): 
-        group_id(group_id), 
-        dpus_per_group(dpus_per_group), 
-        system(dpu::DpuSet::allocate(dpus_per_group, DPU_CONFIG)) { }
-
-    DpuSetWrapper(const DpuSetWrapper&) = delete;
-    DpuSetWrapper& operator=(const DpuSetWrapper&) = delete;
-
-    DpuSetWrapper(DpuSetWrapper&&) noexcept = default;
-    DpuSetWrapper& operator=(DpuSetWrapper&&) noexcept = default;
-
-    dpu::DpuSet& get() { return system; }
-    const dpu::DpuSet& get() const { return system; }
-
-private:
-    int group_id;
-    uint32_t dpus_per_group;
-    dpu::DpuSet system;
-};
-
 struct SharedCandidateMap {
     static constexpr size_t SHARDS = 64;
     std::array<std::mutex, SHARDS> mutexes;
@@ -138,6 +135,14 @@ struct SharedCandidateMap {
     }
 };
 
+// ElePos of one partition of a group, ready for upload
+struct PartitionUpload {
+    std::vector<std::vector<std::vector<ElePosEntry>>> distributed; // [rank][DPU], padded to the longest range of the rank
+    std::vector<std::vector<uint32_t>> counts;                      // Real entries per DPU
+    std::vector<uint32_t> candidate_cnts;                           // Candidates every DPU writes
+    size_t end = 0;                                                 // ElePos consumed up to here
+};
+
 class FPTree {
 public:
     FPTree(int min_support, Database* db): _root(new Node(0, 0, 0, nullptr, 0)), _node_cnt(1), _db(db), _min_support(min_support) {}
@@ -146,7 +151,8 @@ public:
     void build_tree();
     void build_fp_array();
     void build_k1_ele_pos();
-    void dpu_mine_candidates(dpu::DpuSet& system, const std::vector<ElePosEntry>& ele_pos, int group_id);
+    PartitionUpload prepare_partition(dpu::DpuSet& system, const std::vector<ElePosEntry>& ele_pos, size_t begin, int group_id);
+    void merge_partition(const std::vector<std::vector<CandidateEntry>>& candidates, const std::vector<uint32_t>& candidate_cnts, int group_id);
     void mine_candidates(dpu::DpuSet& system, const std::vector<ElePosEntry>& ele_pos, int group_id);
     void mine_frequent_itemsets();
     void delete_tree();
@@ -176,9 +182,10 @@ private:
     std::vector<GlobalFPArrayEntry> _global_fp_array;
     std::array<std::vector<FPArrayEntry>, NR_GROUPS> _local_fp_arrays; // FP Arrays for each DPU(or group)
     std::array<std::vector<ElePosEntry>, NR_GROUPS> _local_elepos_lists; // K=1 ElePos for each DPU(or group)
+    std::array<MramLayout, NR_GROUPS> _mram; // Regions of the mining kernel, planned per local FP-array
     std::vector<std::vector<std::pair<int, uint32_t>>> _node_to_groups; // Map node to groups containing it (group_id, local_pos)
 
-    std::vector<std::unique_ptr<DpuSetWrapper>> _dpu_systems; // DPU systems for each group
+    std::vector<dpu::DpuSet*> _dpu_systems; // DPU systems for each group, owned by DpuResources
     SharedCandidateMap _global_candidate_map; // Global candidate map
     bool _thread_running;
     
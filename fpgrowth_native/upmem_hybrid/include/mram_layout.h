@@ -0,0 +1,46 @@
+#ifndef MRAM_LAYOUT_H
+#define MRAM_LAYOUT_H
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+#include "common.h"
+#include "param.h"
+
+// MRAM regions of mine_candidates for the local FP-array of one group, planned once the FP-arrays
+// are known and passed to the kernel through its __host variables:
+//   [0, elepos_offset)                                     local FP-array
+//   [elepos_offset, candidate_offset)                      ElePos of a partition
+//   [candidate_offset, candidate_offset + candidate_size)  candidates of a partition
+struct MramLayout {
+    uint32_t elepos_offset = 0;
+    uint32_t candidate_offset = 0;
+    uint32_t candidate_size = 0;
+
+    uint64_t elepos_entries() const { return (candidate_offset - elepos_offset) / sizeof(ElePosEntry); }
+    uint64_t max_dpu_candidates() const { return candidate_size / sizeof(CandidateEntry); }
+};
+
+// Everything the FP-array leaves is split between ElePos and candidates in the ratio a DPU fills
+// them, an ElePos entry writes weight / nr_ele_pos candidates on average.
+// Throws when the FP-array leaves less than the minimum of both regions.
+inline MramLayout plan_mram_layout(uint64_t fp_array_bytes, uint64_t weight, uint64_t nr_ele_pos) {
+    uint64_t fp_end = ALIGN_UP(fp_array_bytes, 8);
+    if (fp_end > MRAM_TRX_ARRAY_SZ - MRAM_MIN_ELEPOS_SZ - MRAM_MIN_CANDIDATE_SZ) {
+        throw std::length_error("Local FP-Array does not fit in the MRAM of one DPU");
+    }
+    uint64_t free = MRAM_TRX_ARRAY_SZ - fp_end;
+
+    double written = nr_ele_pos > 0 ? static_cast<double>(weight) / nr_ele_pos : 1;
+    double share = sizeof(ElePosEntry) / (sizeof(ElePosEntry) + written * sizeof(CandidateEntry));
+    uint64_t elepos = std::clamp<uint64_t>(free * share, MRAM_MIN_ELEPOS_SZ, free - MRAM_MIN_CANDIDATE_SZ);
+
+    MramLayout layout;
+    layout.elepos_offset = fp_end;
+    layout.candidate_offset = layout.elepos_offset + ALIGN_DOWN(elepos, sizeof(ElePosEntry));
+    layout.candidate_size = ALIGN_DOWN(MRAM_TRX_ARRAY_SZ - layout.candidate_offset, 8);
+    return layout;
+}
+
+#endif // MRAM_LAYOUT_H
@@ -20,10 +20,12 @@
 #define BLOCK_SIZE (1024)
 #define MRAM_MAX (64ull << 20)
 #define MRAM_TRX_ARRAY_RESERVED (1ull << 20)
-#define MRAM_FP_ARRAY_SZ (16ull << 20)
-#define MRAM_FP_ELEPOS_SZ (4ull << 20)
+// Smallest regions plan_mram_layout() leaves next to the local FP-array, see mram_layout.h
+#define MRAM_MIN_ELEPOS_SZ (512ull << 10)
+#define MRAM_MIN_CANDIDATE_SZ (4ull << 20)
 
 #define ALIGN_DOWN(BYTES, ALIGN) ((BYTES) - ((BYTES) % (ALIGN)))
+#define ALIGN_UP(BYTES, ALIGN) ALIGN_DOWN((BYTES) + (ALIGN) - 1, ALIGN)
 #define MRAM_TRX_ARRAY_SZ ALIGN_DOWN(MRAM_MAX - MRAM_TRX_ARRAY_RESERVED, 8)
 
 #ifndef NR_DB_ITEMS